@@ -39,7 +39,6 @@ int main( int argc, char* argv[] )
     roo::Image<float, roo::TargetDevice, roo::Manage> imggt(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage> imgg(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage> imgk(kw,kh);
-    roo::Image<float, roo::TargetDevice, roo::Manage> imgkT(kw,kh);
 
     roo::Image<float, roo::TargetDevice, roo::Manage>  imgu(w,h);
     roo::Image<float2, roo::TargetDevice, roo::Manage> imgp(w,h);
@@ -48,6 +47,9 @@ int main( int argc, char* argv[] )
     roo::Image<float, roo::TargetDevice, roo::Manage>  imgAu(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage>  imgATq(w,h);
 
+    // Blur operator A, using FFT for large kernels
+    roo::ConvolutionPlan blur;
+
     ActivateDrawImage<float> adgt(imggt, GL_LUMINANCE32F_ARB, true, true);
     ActivateDrawImage<float> adg(imgg, GL_LUMINANCE32F_ARB, true, true);
     ActivateDrawImage<float> adk(imgk, GL_LUMINANCE32F_ARB, false, true);
@@ -82,8 +84,8 @@ int main( int argc, char* argv[] )
                 kernel.MemcpyFromHost(images[1].ptr );
                 roo::ElementwiseScaleBias<float,unsigned char,float>(imggt, img, 1.0f/255.0f);
                 roo::ElementwiseScaleBias<float,unsigned char,float>(imgk, kernel, 1.0f/255.0f);
-                roo::Transpose<float,float>(imgkT, imgk);
-                roo::Convolution<float,float,float,float>(imgg, imggt, imgk, kw/2, kh/2);
+                blur.SetKernel(imgk, kw/2, kh/2, w, h);
+                blur.Convolve(imgg, imggt);
                 imgu.CopyFrom(imgg);
                 imgp.Memset(0);
                 imgq.Memset(0);
@@ -94,9 +96,9 @@ int main( int argc, char* argv[] )
             for(int i=0; i<1; ++i ) {
 //                roo::TVL1GradU_DualAscentP(imgp,imgu,sigma_p);
                 roo::HuberGradU_DualAscentP(imgp,imgu,sigma_p,alpha);
-                roo::Convolution<float,float,float,float>(imgAu, imgu, imgk, kw/2, kh/2);
+                blur.Convolve(imgAu, imgu);
                 roo::DeconvolutionDual_qAscent(imgq,imgAu,imgg,sigma_q,lambda);
-                roo::Convolution<float,float,float,float>(imgATq, imgq, imgkT, kw/2, kh/2);
+                blur.Convolve(imgATq, imgq, true);
                 roo::Deconvolution_uDescent(imgu,imgp,imgATq, tau, lambda);
             }
         }
@@ -36,6 +36,7 @@ int main( int argc, char* argv[] )
     roo::Image<float2, roo::TargetDevice, roo::Manage> imgv(w,h);
     roo::Image<float4, roo::TargetDevice, roo::Manage> imgq(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage> imgr(w,h);
+    roo::Image<unsigned char, roo::TargetDevice, roo::Manage> scratch(w*sizeof(float4)*2,h);
 
     ActivateDrawImage<float> adg(imgg, GL_LUMINANCE32F_ARB, true, true);
     ActivateDrawImage<float> adu(imgu, GL_LUMINANCE32F_ARB, true, true);
@@ -52,6 +53,7 @@ int main( int argc, char* argv[] )
     Var<float> tau("ui.tau", 0.05, 0, 0.1);
     Var<float> lambda("ui.lambda", 1.2, 0, 10);
     Var<float> alpha("ui.alpha", 0.002, 0, 0.005);
+    Var<bool> coarse_to_fine("ui.coarse_to_fine", false, true);
 
     Var<bool> tgv_do("ui.tgv", false, true);
     Var<float> tgv_a1("ui.alpha1", 0.9, 0, 0.5);
@@ -72,6 +74,11 @@ int main( int argc, char* argv[] )
             imgu.CopyFrom(imgg);
             imgp.Memset(0);
 
+            if(coarse_to_fine) {
+                // Warm start u and p from a 3 level coarse-to-fine solve
+                roo::HuberL2_PrimalDualCoarseToFine<3>(imgu,imgp,imgg,roo::Image<float>(),sigma,tau,alpha,lambda,100,0,0,scratch);
+            }
+
             imgq.Memset(0);
             imgr.Memset(0);
 
@@ -33,6 +33,7 @@ int main( int argc, char* argv[] )
     roo::Image<float2, roo::TargetDevice, roo::Manage> imgp(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage> imgdivp(w,h);
     roo::Image<float, roo::TargetDevice, roo::Manage> imglambda(w,h);
+    roo::Image<unsigned char, roo::TargetDevice, roo::Manage> scratch(w*sizeof(float4)*2,h);
 
     const bool bilinear = false;
     ActivateDrawImage<float> adg(imgg, GL_LUMINANCE32F_ARB, bilinear, true);
@@ -57,10 +58,13 @@ int main( int argc, char* argv[] )
     Var<float> alpha("ui.alpha", 0.002, 0, 0.005);
 
     Var<float> r("ui.r", 10, 1, 50);
+    Var<bool> coarse_to_fine("ui.coarse_to_fine", true, true);
 
     pangolin::RegisterKeyPressCallback(' ', [&run](){run = !run;} );
     pangolin::RegisterKeyPressCallback(PANGO_SPECIAL + pangolin::PANGO_KEY_RIGHT, [&step](){step=true;} );
 
+    bool mask_changed = false;
+
     for(unsigned long frame=0; !pangolin::ShouldQuit(); ++frame)
     {
         bool go = (frame==0) || Pushed(step);
@@ -76,6 +80,16 @@ int main( int argc, char* argv[] )
             }
         }
 
+        if(mask_changed && !handler2d.IsSelected()) {
+            if(coarse_to_fine) {
+                // Once a stroke ends, warm start u and p from a 3 level
+                // coarse-to-fine solve weighted by the mask, so holes fill
+                // in at coarse levels.
+                roo::HuberL2_PrimalDualCoarseToFine<3>(imgu,imgp,imgg,imglambda,sigma,tau,alpha,lambda,100,0,0,scratch);
+            }
+            mask_changed = false;
+        }
+
         go |= run;
         if(go) {
             for(int i=0; i<10; ++i ) {
@@ -88,6 +102,7 @@ int main( int argc, char* argv[] )
         if(handler2d.IsSelected()) {
             Eigen::Vector2d p = handler2d.GetSelectedPoint(true);
             roo::PaintCircle<float>(imglambda, 0.0f, p[0], p[1], r);
+            mask_changed = true;
         }
 
         /////////////////////////////////////////////////////////////
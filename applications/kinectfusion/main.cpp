@@ -298,43 +298,19 @@ int main(int argc, char* argv[])
           //                    roo::RaycastSdf(ray_d[l], ray_n[l], ray_i[l], work_vol, T_wl.matrix3x4(), fu/(1<<l), fv/(1<<l), w/(2 * 1<<l) - 0.5, h/(2 * 1<<l) - 0.5, knear,kfar, true );
           //                    roo::DepthToVbo(ray_v[l], ray_d[l], fu/(1<<l), fv/(1<<l), w/(2.0f * (1<<l)) - 0.5, h/(2.0f * (1<<l)) - 0.5 );
 
-          for(int l=MaxLevels-1; l >=0; --l)
-          {
-            const Eigen::Matrix3d Kdepth = K[l].Matrix();
-
-            for(int i=0; i<its[l]; ++i ) {
-              const Eigen::Matrix<double, 3,4> mKT_lp = Kdepth * T_lp.matrix3x4();
-              const Eigen::Matrix<double, 3,4> mT_pl = T_lp.inverse().matrix3x4();
-              roo::LeastSquaresSystem<float,6> lss = roo::PoseRefinementProjectiveIcpPointPlane(
-                    kin_v[l], ray_v[l], ray_n[l], mKT_lp, mT_pl, icp_c, dScratch, dDebug.SubImage(0,0,w>>l,h>>l)
-                    );
-
-              Eigen::Matrix<double,6,6> sysJTJ = lss.JTJ;
-              Eigen::Matrix<double,6,1> sysJTy = lss.JTy;
-
-              // Add a week prior on our pose
-              const double motionSigma = 0.2;
-              const double depthSigma = 0.1;
-              sysJTJ += (depthSigma / motionSigma) * Eigen::Matrix<double,6,6>::Identity();
-
-              rmse = sqrt(lss.sqErr / lss.obs);
-              tracking_good = rmse < max_rmse;
-
-              if(l == MaxLevels-1 && MaxLevels > 1) {
-                // Solve for rotation only
-                Eigen::FullPivLU<Eigen::Matrix<double,3,3> > lu_JTJ( sysJTJ.block<3,3>(3,3) );
-                Eigen::Matrix<double,3,1> x = -1.0 * lu_JTJ.solve( sysJTy.segment<3>(3) );
-                T_lp = T_lp * Sophus::SE3d(Sophus::SO3d::exp(x), Eigen::Vector3d(0,0,0) );
-              }else{
-                Eigen::FullPivLU<Eigen::Matrix<double,6,6> > lu_JTJ( sysJTJ );
-                Eigen::Matrix<double,6,1> x = -1.0 * lu_JTJ.solve( sysJTy );
-                if( isFinite(x) ) {
-                  T_lp = T_lp * Sophus::SE3d::exp(x);
-                }
-              }
+          // Add a week prior on our pose
+          const double motionSigma = 0.2;
+          const double depthSigma = 0.1;
 
-            }
-          }
+          const roo::IcpState icp = roo::IcpPointPlaneCoarseToFine<MaxLevels,roo::RobustTukey>(
+                kin_v, ray_v, ray_n, K, T_lp.matrix3x4(), its, icp_c, depthSigma / motionSigma, dScratch, dDebug
+                );
+
+          const Eigen::Matrix<double,3,4> mT_lp = icp.T_lr;
+          T_lp = Sophus::SE3d( Eigen::Quaterniond(mT_lp.block<3,3>(0,0)).normalized(), mT_lp.col(3) );
+
+          rmse = icp.stats.Rmse();
+          tracking_good = rmse < max_rmse;
 
           if(tracking_good) {
             T_wl = T_wl * T_lp.inverse();
@@ -81,7 +81,7 @@ function(install_package)
     set( PACKAGE_LIBS "${PACKAGE_LIBS} -L${var}" )
   endforeach()
   foreach(var IN LISTS PACKAGE_LINK_LIBS )
-    if( EXISTS ${var} OR  ${var} MATCHES "-framework*" )
+    if( EXISTS ${var} OR  ${var} MATCHES "^-" )
       set( PACKAGE_LIBS "${PACKAGE_LIBS} ${var}" )
     else() # assume it's just a -l call??
       set( PACKAGE_LIBS "${PACKAGE_LIBS} -l${var}" )
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Mat.h>
+#include <kangaroo/ImageIntrinsics.h>
+
+namespace roo
+{
+
+enum CameraModelType
+{
+    CameraPinhole = 0,
+    // k = (k1, k2, p1, p2, k3), as OpenCV / Matlab calibration toolbox
+    CameraRadTan = 1,
+    // Equidistant fisheye, k = (k1, k2, k3, k4), as OpenCV fisheye / Kannala-Brandt
+    CameraFisheye = 2
+};
+
+// Pinhole intrinsics with optional lens distortion. Distortion coefficients
+// act on normalised coordinates, so are unchanged over pyramid levels.
+struct CameraModel
+{
+    //////////////////////////////////////////////////////
+    // Constructors
+    //////////////////////////////////////////////////////
+
+    inline __host__ __device__
+    CameraModel()
+        : type(CameraPinhole), fu(0), fv(0), u0(0), v0(0)
+    {
+        for(int i=0; i < 5; ++i) k[i] = 0;
+    }
+
+    inline __host__ __device__
+    CameraModel(const ImageIntrinsics& K)
+        : type(CameraPinhole), fu(K.fu), fv(K.fv), u0(K.u0), v0(K.v0)
+    {
+        for(int i=0; i < 5; ++i) k[i] = 0;
+    }
+
+    inline __host__ __device__
+    static CameraModel RadTan(const ImageIntrinsics& K, float k1, float k2, float p1, float p2, float k3 = 0)
+    {
+        CameraModel cam(K);
+        cam.type = CameraRadTan;
+        cam.k[0] = k1; cam.k[1] = k2; cam.k[2] = p1; cam.k[3] = p2; cam.k[4] = k3;
+        return cam;
+    }
+
+    inline __host__ __device__
+    static CameraModel Fisheye(const ImageIntrinsics& K, float k1, float k2, float k3, float k4)
+    {
+        CameraModel cam(K);
+        cam.type = CameraFisheye;
+        cam.k[0] = k1; cam.k[1] = k2; cam.k[2] = k3; cam.k[3] = k4;
+        return cam;
+    }
+
+    //////////////////////////////////////////////////////
+    // Image projection
+    //////////////////////////////////////////////////////
+
+    // Distorted normalised coordinates of ray P_c
+    inline __host__ __device__
+    float2 Distort(const float3 P_c) const
+    {
+        if(type == CameraFisheye) {
+            const float r = sqrtf(P_c.x*P_c.x + P_c.y*P_c.y);
+            if(r < 1E-8f) return make_float2(0,0);
+            const float theta = atan2f(r, P_c.z);
+            const float t2 = theta*theta;
+            const float thetad = theta * (1 + t2*(k[0] + t2*(k[1] + t2*(k[2] + t2*k[3]))));
+            const float s = thetad / r;
+            return make_float2(P_c.x*s, P_c.y*s);
+        }
+
+        const float x = P_c.x / P_c.z;
+        const float y = P_c.y / P_c.z;
+        if(type == CameraRadTan) {
+            const float r2 = x*x + y*y;
+            const float radial = 1 + r2*(k[0] + r2*(k[1] + r2*k[4]));
+            return make_float2(
+                x*radial + 2*k[2]*x*y + k[3]*(r2 + 2*x*x),
+                y*radial + k[2]*(r2 + 2*y*y) + 2*k[3]*x*y
+            );
+        }
+        return make_float2(x, y);
+    }
+
+    inline __host__ __device__
+    float2 Project(const float3 P_c) const
+    {
+        const float2 pd = Distort(P_c);
+        return make_float2(u0 + fu*pd.x, v0 + fv*pd.y);
+    }
+
+    //////////////////////////////////////////////////////
+    // Intrinsics for pow 2 pyramid
+    //////////////////////////////////////////////////////
+
+    inline __host__ __device__
+    ImageIntrinsics Intrinsics() const
+    {
+        return ImageIntrinsics(fu, fv, u0, v0);
+    }
+
+    inline __host__ __device__
+    CameraModel operator[](int l) const
+    {
+        const ImageIntrinsics Kl = Intrinsics()[l];
+        CameraModel cam = *this;
+        cam.fu = Kl.fu; cam.fv = Kl.fv; cam.u0 = Kl.u0; cam.v0 = Kl.v0;
+        return cam;
+    }
+
+    //////////////////////////////////////////////////////
+    // Member variables
+    //////////////////////////////////////////////////////
+
+    int type;
+    float fu;
+    float fv;
+    float u0;
+    float v0;
+    float k[5];
+};
+
+// H_on = R_on * K_new^-1, taking pixel (x,y,1) of new (e.g. rectified) image
+// to ray in original camera frame. Rays along a row are affine in x with
+// step column 0 of H_on, which host lookup generation exploits.
+inline __host__ __device__
+Mat<float,3,3> LookupRayMatrix(const ImageIntrinsics& K_new, const Mat<float,3,3>& R_on)
+{
+    Mat<float,3,3> H_on;
+    for(int r=0; r < 3; ++r) {
+        H_on(r,0) = R_on(r,0) / K_new.fu;
+        H_on(r,1) = R_on(r,1) / K_new.fv;
+        H_on(r,2) = R_on(r,2) - R_on(r,0)*K_new.u0/K_new.fu - R_on(r,1)*K_new.v0/K_new.fv;
+    }
+    return H_on;
+}
+
+}
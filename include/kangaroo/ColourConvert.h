@@ -0,0 +1,163 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+// Colour of top-left 2x2 Bayer cell, in raster order
+enum BayerPattern
+{
+    BayerRGGB = 0,
+    BayerGRBG = 1,
+    BayerGBRG = 2,
+    BayerBGGR = 3
+};
+
+//////////////////////////////////////////////////////
+// Per pixel colour operations, shared by host and device.
+// Integer arithmetic throughout for 8 bit results. Kernels can sample raw
+// camera formats with these directly, avoiding a separate conversion pass.
+//////////////////////////////////////////////////////
+
+// BT.601 luma, 8 bit fixed point weights
+inline __host__ __device__
+int RgbToLuma(int r, int g, int b)
+{
+    return (77*r + 150*g + 29*b + 128) >> 8;
+}
+
+inline __host__ __device__
+int ClampByte(int v)
+{
+    return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+// BT.601 limited range YCbCr to RGB
+inline __host__ __device__
+void YuvToRgb(int y, int u, int v, int& r, int& g, int& b)
+{
+    const int c = 298*(y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    r = ClampByte( (c + 409*e) >> 8 );
+    g = ClampByte( (c - 100*d - 208*e) >> 8 );
+    b = ClampByte( (c + 516*d) >> 8 );
+}
+
+template<typename To>
+inline __host__ __device__
+To PixelFromRgb(int r, int g, int b);
+
+template<>
+inline __host__ __device__
+unsigned char PixelFromRgb(int r, int g, int b)
+{
+    return RgbToLuma(r,g,b);
+}
+
+template<>
+inline __host__ __device__
+float PixelFromRgb(int r, int g, int b)
+{
+    return RgbToLuma(r,g,b) / 255.0f;
+}
+
+template<>
+inline __host__ __device__
+uchar3 PixelFromRgb(int r, int g, int b)
+{
+    return make_uchar3(r,g,b);
+}
+
+template<>
+inline __host__ __device__
+uchar4 PixelFromRgb(int r, int g, int b)
+{
+    return make_uchar4(r,g,b,255);
+}
+
+template<>
+inline __host__ __device__
+float4 PixelFromRgb(int r, int g, int b)
+{
+    return make_float4(r/255.0f, g/255.0f, b/255.0f, 1.0f);
+}
+
+// Luma of uchar3 / uchar4 pixel as unsigned char, or float in [0,1]
+template<typename To, typename Ti>
+inline __host__ __device__
+To RgbToGray(Ti p)
+{
+    const int l = RgbToLuma(p.x, p.y, p.z);
+    return PixelFromRgb<To>(l,l,l);
+}
+
+// Pixel (x,y) of packed YUYV image, stored as (Y0,U,Y1,V) per pixel pair.
+template<typename To, typename Target, typename Management>
+inline __host__ __device__
+To YUYVPixel(const Image<uchar4,Target,Management>& in, int x, int y)
+{
+    const uchar4 q = in(x/2, y);
+    int r, g, b;
+    YuvToRgb( (x & 1) ? q.z : q.x, q.y, q.w, r, g, b);
+    return PixelFromRgb<To>(r,g,b);
+}
+
+// Pixel (x,y) of NV12 image: h rows of Y followed by h/2 rows of
+// interleaved (U,V) at half resolution.
+template<typename To, typename Target, typename Management>
+inline __host__ __device__
+To NV12Pixel(const Image<unsigned char,Target,Management>& in, int h, int x, int y)
+{
+    const unsigned char* uv = in.RowPtr(h + y/2) + (x & ~1);
+    int r, g, b;
+    YuvToRgb(in(x,y), uv[0], uv[1], r, g, b);
+    return PixelFromRgb<To>(r,g,b);
+}
+
+// Mirror about border, preserving Bayer parity
+inline __host__ __device__
+int BayerIndex(int i, int n)
+{
+    return i < 0 ? -i : (i >= n ? 2*n - 2 - i : i);
+}
+
+// Bilinear demosaic of pixel (x,y) of raw Bayer image
+template<typename To, typename Target, typename Management>
+inline __host__ __device__
+To BayerPixel(const Image<unsigned char,Target,Management>& raw, int x, int y, BayerPattern pattern)
+{
+    const int w = raw.w;
+    const int h = raw.h;
+    const unsigned char* rm = raw.RowPtr(BayerIndex(y-1,h));
+    const unsigned char* r0 = raw.RowPtr(y);
+    const unsigned char* rp = raw.RowPtr(BayerIndex(y+1,h));
+    const int xm = BayerIndex(x-1,w);
+    const int xp = BayerIndex(x+1,w);
+
+    const int c = r0[x];
+    const int hor = (r0[xm] + r0[xp] + 1) >> 1;
+    const int ver = (rm[x] + rp[x] + 1) >> 1;
+    const int cross = (r0[xm] + r0[xp] + rm[x] + rp[x] + 2) >> 2;
+    const int diag = (rm[xm] + rm[xp] + rp[xm] + rp[xp] + 2) >> 2;
+
+    // Parity relative to red site
+    const int px = (x ^ pattern) & 1;
+    const int py = (y ^ (pattern >> 1)) & 1;
+
+    if(!px && !py) {
+        return PixelFromRgb<To>(c, cross, diag);
+    }else if(px && py) {
+        return PixelFromRgb<To>(diag, cross, c);
+    }else if(!py) {
+        // Green on red row
+        return PixelFromRgb<To>(hor, c, ver);
+    }else{
+        // Green on blue row
+        return PixelFromRgb<To>(ver, c, hor);
+    }
+}
+
+}
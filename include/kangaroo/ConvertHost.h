@@ -0,0 +1,80 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/pixel_convert.h>
+#include <kangaroo/ColourConvert.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host image conversion
+// CPU counterparts of cu_convert.cu, over the same per pixel operations.
+// Inner loops run over contiguous row pointers, and rows are converted in
+// parallel.
+//////////////////////////////////////////////////////
+
+template<typename To, typename Ti, typename Management>
+inline void ConvertImage(Image<To,TargetHost> out, const Image<Ti,TargetHost,Management>& in)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        To* po = out.RowPtr(y);
+        const Ti* pi = in.RowPtr(y);
+        for(int x=0; x < (int)out.w; ++x) {
+            po[x] = ConvertPixel<To,Ti>(pi[x]);
+        }
+    }
+}
+
+template<typename To, typename Ti, typename Management>
+inline void ConvertRgbToGray(Image<To,TargetHost> out, const Image<Ti,TargetHost,Management>& in)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        To* po = out.RowPtr(y);
+        const Ti* pi = in.RowPtr(y);
+        for(int x=0; x < (int)out.w; ++x) {
+            po[x] = RgbToGray<To,Ti>(pi[x]);
+        }
+    }
+}
+
+template<typename To, typename Management>
+inline void ConvertYUYV(Image<To,TargetHost> out, const Image<uchar4,TargetHost,Management>& in)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        To* po = out.RowPtr(y);
+        for(int x=0; x < (int)out.w; ++x) {
+            po[x] = YUYVPixel<To>(in, x, y);
+        }
+    }
+}
+
+template<typename To, typename Management>
+inline void ConvertNV12(Image<To,TargetHost> out, const Image<unsigned char,TargetHost,Management>& in)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        To* po = out.RowPtr(y);
+        for(int x=0; x < (int)out.w; ++x) {
+            po[x] = NV12Pixel<To>(in, out.h, x, y);
+        }
+    }
+}
+
+template<typename To, typename Management>
+inline void DemosaicBayer(Image<To,TargetHost> out, const Image<unsigned char,TargetHost,Management>& in, BayerPattern pattern)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        To* po = out.RowPtr(y);
+        for(int x=0; x < (int)out.w; ++x) {
+            po[x] = BayerPixel<To>(in, x, y, pattern);
+        }
+    }
+}
+
+}
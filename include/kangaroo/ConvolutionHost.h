@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cassert>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/Mat.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host separable convolution
+// CPU counterpart of ConvolutionSeparable in cu_convolution.cu, with the
+// same centred kernels of radius RAD and Neumann boundary, which needs
+// RAD < w and RAD < h. The row pass only reflects within RAD of the image
+// edges. The column pass gathers the 2*RAD+1 source rows of each output
+// row once and sweeps them together. Rows are filtered in parallel.
+//////////////////////////////////////////////////////
+
+template<typename OT, typename IT, unsigned RAD>
+inline void ConvolutionSeparable(
+    Image<OT,TargetHost> out, Image<IT,TargetHost> in, Image<float,TargetHost> temp,
+    const Mat<float,2*RAD+1> krow, const Mat<float,2*RAD+1> kcol
+) {
+    assert(RAD < in.w && RAD < in.h);
+
+    const int w = out.w;
+    const int h = out.h;
+    const int r = RAD;
+
+#pragma omp parallel for
+    for(int y=0; y < h; ++y) {
+        const IT* pi = in.RowPtr(y);
+        float* pt = temp.RowPtr(y);
+        for(int x=0; x < w; ++x) {
+            float sum = 0;
+            if(x >= r && x < (int)in.w - r) {
+                for(int k=0; k <= 2*r; ++k) {
+                    sum += krow[k] * (float)pi[x - r + k];
+                }
+            }else{
+                for(int k=0; k <= 2*r; ++k) {
+                    sum += krow[k] * (float)in.GetConditionNeumann(x - r + k, y);
+                }
+            }
+            pt[x] = sum;
+        }
+    }
+
+#pragma omp parallel for
+    for(int y=0; y < h; ++y) {
+        const float* rows[2*RAD+1];
+        for(int k=0; k <= 2*r; ++k) {
+            rows[k] = &temp.GetConditionNeumann(0, y - r + k);
+        }
+
+        OT* po = out.RowPtr(y);
+        for(int x=0; x < w; ++x) {
+            float sum = 0;
+            for(int k=0; k <= 2*r; ++k) {
+                sum += kcol[k] * rows[k][x];
+            }
+            po[x] = sum;
+        }
+    }
+}
+
+}
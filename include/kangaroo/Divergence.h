@@ -36,8 +36,9 @@ float4 ProjectUnitBall(float4 val, float maxrad = 1.0f)
 // Gradient of u
 //////////////////////////////////////////////////////
 
+template<typename Target, typename Management>
 inline __host__ __device__
-float2 GradUFwd(const Image<float>& imgu, float u, size_t x, size_t y)
+float2 GradUFwd(const Image<float,Target,Management>& imgu, float u, size_t x, size_t y)
 {
     float2 du = make_float2(0,0);
     if(x < imgu.w-1 ) du.x = imgu(x+1,y) - u;
@@ -49,8 +50,9 @@ float2 GradUFwd(const Image<float>& imgu, float u, size_t x, size_t y)
 // Divergence operator
 //////////////////////////////////////////////////////
 
+template<typename Target, typename Management>
 inline __host__ __device__
-float DivA(const Image<float2>& A, int x, int y)
+float DivA(const Image<float2,Target,Management>& A, int x, int y)
 {
     const float2 p = A(x,y);
     float divA = p.x + p.y;
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/ImageIntrinsics.h>
+#include <kangaroo/MatUtils.h>
+#include <kangaroo/reweighting.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host dense photometric alignment
+// CPU counterpart of PoseRefinementFromDepthESM in cu_model_refinement.cu.
+// Reference points, intensities and inverse compositional Jacobians are
+// computed once per keyframe. BuildSystem runs each chunk of EsmHostLanes
+// points through projection, sampling and accumulation without per point
+// branches: points that project outside the live image are sampled at a
+// safe position and given zero weight. Threads sum private systems, which
+// are added together at the end.
+//////////////////////////////////////////////////////
+
+const int EsmHostLanes = 16;
+
+// Jacobian of intensity at projection of P w.r.t. se3 perturbation of P,
+// given image gradient (gx,gy), dI/dP = g and P = (X,Y,Z).
+inline __host__ __device__
+Mat<float,1,6> EsmPointJacobian(float g0, float g1, float g2, float X, float Y, float Z)
+{
+    Mat<float,1,6> J;
+    J(0) = g0;
+    J(1) = g1;
+    J(2) = g2;
+    J(3) = -g1*Z + g2*Y;
+    J(4) = +g0*Z - g2*X;
+    J(5) = -g0*Y + g1*X;
+    return J;
+}
+
+template<typename Ti>
+class EsmAlignHost
+{
+public:
+    // Use reference Jacobians only (inverse compositional) instead of the
+    // average of reference and live Jacobians (ESM). Cheaper per iteration,
+    // but converges more slowly for large motions.
+    bool inverse_compositional;
+
+    inline EsmAlignHost()
+        : inverse_compositional(false)
+    {
+    }
+
+    // Precompute reference data for keyframe image and registered depth,
+    // keeping pixels with depth in (min_depth, max_depth) and nonzero
+    // gradient.
+    template<typename ManagementI, typename ManagementD>
+    inline void SetKeyframe(
+        const Image<Ti,TargetHost,ManagementI>& img, const Image<float,TargetHost,ManagementD>& depth,
+        const ImageIntrinsics& K, float min_depth = 0, float max_depth = 1E10f
+    ) {
+        m_K = K;
+        m_P.clear();
+        m_J.clear();
+
+        for(int v=1; v < (int)img.h-1; ++v) {
+            for(int u=1; u < (int)img.w-1; ++u) {
+                const float d = depth(u,v);
+                if( !(d > min_depth && d < max_depth) ) continue;
+
+                const Mat<float,1,2> dI = img.template GetCentralDiff<float>(u,v);
+                if( dI(0) == 0 && dI(1) == 0 ) continue;
+
+                const float3 P = K.Unproject((float)u, (float)v, d);
+                m_P.push_back( make_float4(P.x, P.y, P.z, img(u,v)) );
+                m_J.push_back( EsmPointJacobian(
+                    dI(0)*K.fu/P.z, dI(1)*K.fv/P.z, -(dI(0)*K.fu*P.x + dI(1)*K.fv*P.y)/(P.z*P.z),
+                    P.x, P.y, P.z
+                ) );
+            }
+        }
+    }
+
+    inline size_t NumPoints() const
+    {
+        return m_P.size();
+    }
+
+    // Normal equations for perturbation x in T_lr * exp(x), for residual
+    // live(K T_lr P_r) - I_r with Robust reweighting of scale c.
+    template<typename Robust, typename Management>
+    inline LeastSquaresSystem<float,6> BuildSystem(
+        const Image<Ti,TargetHost,Management>& live, const Mat<float,3,4>& T_lr, float c
+    ) const {
+        const int n = (int)m_P.size();
+        const int chunks = (n + EsmHostLanes - 1) / EsmHostLanes;
+
+        LeastSquaresSystem<float,6> sum;
+        sum.SetZero();
+
+#pragma omp parallel
+        {
+            LeastSquaresSystem<float,6> lss;
+            lss.SetZero();
+
+#pragma omp for
+            for(int chunk=0; chunk < chunks; ++chunk) {
+                const int i0 = chunk*EsmHostLanes;
+                float Plx[EsmHostLanes], Ply[EsmHostLanes], Plz[EsmHostLanes];
+                float sx[EsmHostLanes], sy[EsmHostLanes], mask[EsmHostLanes];
+                float y[EsmHostLanes], dIx[EsmHostLanes], dIy[EsmHostLanes];
+
+                // Transform and project. Lanes past n repeat the last point,
+                // and invalid lanes sample at (2,2) and are masked out.
+                for(int l=0; l < EsmHostLanes; ++l) {
+                    const float4 Pr = m_P[std::min(i0+l, n-1)];
+                    Plx[l] = T_lr(0,0)*Pr.x + T_lr(0,1)*Pr.y + T_lr(0,2)*Pr.z + T_lr(0,3);
+                    Ply[l] = T_lr(1,0)*Pr.x + T_lr(1,1)*Pr.y + T_lr(1,2)*Pr.z + T_lr(1,3);
+                    Plz[l] = T_lr(2,0)*Pr.x + T_lr(2,1)*Pr.y + T_lr(2,2)*Pr.z + T_lr(2,3);
+                    const float px = m_K.fu * Plx[l] / Plz[l] + m_K.u0;
+                    const float py = m_K.fv * Ply[l] / Plz[l] + m_K.v0;
+                    const bool valid = (i0+l < n) & (Plz[l] > 0) & (2 <= px) & (px < live.w-2.0f) & (2 <= py) & (py < live.h-2.0f);
+                    mask[l] = valid ? 1.0f : 0.0f;
+                    sx[l] = valid ? px : 2.0f;
+                    sy[l] = valid ? py : 2.0f;
+                    Plz[l] = valid ? Plz[l] : 1.0f;
+                }
+
+                // Gather residuals and live gradients
+                for(int l=0; l < EsmHostLanes; ++l) {
+                    y[l] = live.template GetBilinear<float>(sx[l], sy[l]) - m_P[std::min(i0+l, n-1)].w;
+                }
+                if(!inverse_compositional) {
+                    for(int l=0; l < EsmHostLanes; ++l) {
+                        const Mat<float,1,2> dIl = live.template GetCentralDiff<float>(sx[l], sy[l]);
+                        dIx[l] = dIl(0);
+                        dIy[l] = dIl(1);
+                    }
+                }
+
+                // Accumulate, with zero weight for masked lanes
+                for(int l=0; l < EsmHostLanes; ++l) {
+                    const int i = std::min(i0+l, n-1);
+                    Mat<float,1,6> J = m_J[i];
+                    if(!inverse_compositional) {
+                        // Live Jacobian w.r.t. same perturbation, via R_lr
+                        const float4 Pr = m_P[i];
+                        const float z = Plz[l];
+                        const float g0 = dIx[l]*m_K.fu/z;
+                        const float g1 = dIy[l]*m_K.fv/z;
+                        const float g2 = -(g0*Plx[l] + g1*Ply[l])/z;
+                        const Mat<float,1,6> Jl = EsmPointJacobian(
+                            g0*T_lr(0,0) + g1*T_lr(1,0) + g2*T_lr(2,0),
+                            g0*T_lr(0,1) + g1*T_lr(1,1) + g2*T_lr(2,1),
+                            g0*T_lr(0,2) + g1*T_lr(1,2) + g2*T_lr(2,2),
+                            Pr.x, Pr.y, Pr.z
+                        );
+                        for(int k=0; k < 6; ++k) J(k) = 0.5f*(J(k) + Jl(k));
+                    }
+
+                    const float w = mask[l] * Robust::Weight(y[l],c);
+                    lss.JTJ += OuterProduct(J,w);
+                    lss.JTy += mul_aTb(J,y[l]*w);
+                    lss.sqErr += mask[l] * y[l]*y[l];
+                    lss.obs += (unsigned)mask[l];
+                }
+            }
+
+#pragma omp critical
+            sum += lss;
+        }
+
+        return sum;
+    }
+
+    // Gauss-Newton on T_lr, stopping after max_its or once the step is
+    // smaller than min_step. Returns system of final iteration.
+    template<typename Robust, typename Management>
+    inline LeastSquaresSystem<float,6> Align(
+        const Image<Ti,TargetHost,Management>& live, Mat<float,3,4>& T_lr, float c,
+        int max_its = 10, float min_step = 1E-6f
+    ) const {
+        LeastSquaresSystem<float,6> lss;
+        lss.SetZero();
+
+        for(int it=0; it < max_its; ++it) {
+            lss = BuildSystem<Robust>(live, T_lr, c);
+
+            Mat<float,6> x;
+            if( !CholeskySolve(lss.JTJ, lss.JTy, x) ) break;
+            x = -1.0f * x;
+            T_lr = T_lr * SE3exp(x);
+
+            if( sqrtf(x*x) < min_step ) break;
+        }
+        return lss;
+    }
+
+protected:
+    ImageIntrinsics m_K;
+
+    // Reference point and intensity (in w)
+    std::vector<float4> m_P;
+
+    // Reference (inverse compositional) Jacobians
+    std::vector<Mat<float,1,6> > m_J;
+};
+
+}
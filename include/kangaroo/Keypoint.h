@@ -0,0 +1,114 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+// Sparse image feature. x,y are in level 0 pixel coordinates.
+struct Keypoint
+{
+    inline __device__ __host__
+    Keypoint()
+    {
+    }
+
+    inline __device__ __host__
+    Keypoint(float x, float y, float score, int level)
+        : x(x), y(y), score(score), level(level)
+    {
+    }
+
+    // Position within pyramid level of Box reduced pyramid.
+    inline __device__ __host__
+    float2 LevelPos() const
+    {
+        const float s = 1.0f / (1 << level);
+        return make_float2( (x + 0.5f)*s - 0.5f, (y + 0.5f)*s - 0.5f );
+    }
+
+    inline __device__ __host__
+    bool Valid() const
+    {
+        return level >= 0;
+    }
+
+    float x;
+    float y;
+    float score;
+    int level;
+};
+
+// Light and dark bit masks of Bresenham circle (radius 3) about (x,y), with
+// bit i clockwise from (0,-3). sad_* accumulate intensity beyond threshold.
+template<typename T, typename Target, typename Management>
+inline __device__ __host__
+void SegmentTestMasks(
+    const Image<T,Target,Management>& img, int x, int y, int threshold,
+    unsigned int& light, unsigned int& dark, int& sad_light, int& sad_dark
+) {
+    const int cx[16] = { 0, 1, 2, 3, 3, 3, 2, 1, 0,-1,-2,-3,-3,-3,-2,-1};
+    const int cy[16] = {-3,-3,-2,-1, 0, 1, 2, 3, 3, 3, 2, 1, 0,-1,-2,-3};
+
+    const int p = img(x,y);
+    light = 0;
+    dark = 0;
+    sad_light = 0;
+    sad_dark = 0;
+
+#pragma unroll
+    for(int i=0; i<16; ++i) {
+        const int q = img(x+cx[i], y+cy[i]);
+        if( q > p + threshold ) {
+            light |= 1 << i;
+            sad_light += q - p - threshold;
+        }else if( q < p - threshold ) {
+            dark |= 1 << i;
+            sad_dark += p - q - threshold;
+        }
+    }
+}
+
+// True if 16 bit circular mask contains arc_length contiguous set bits
+// (9 for FAST-9, 12 for FAST-12).
+inline __device__ __host__
+bool SegmentTestArc(unsigned int mask, int arc_length)
+{
+    const unsigned int circ = mask | (mask << 16);
+    unsigned int run = circ;
+    for(int i=1; i < arc_length; ++i) {
+        run &= circ >> i;
+    }
+    return (run & 0xFFFF) != 0;
+}
+
+// Harris response from central difference gradients over 3x3 window.
+template<typename T, typename Target, typename Management>
+inline __device__ __host__
+float HarrisResponse(const Image<T,Target,Management>& img, int x, int y, float lambda)
+{
+    float sum_Ixx = 0;
+    float sum_Iyy = 0;
+    float sum_Ixy = 0;
+
+    for(int sy=-1; sy<=1; ++sy) {
+#pragma unroll
+        for(int sx=-1; sx<=1; ++sx) {
+            Mat<float,1,2> dI = img.template GetCentralDiff<float>(x+sx,y+sy);
+            sum_Ixx += dI(0) * dI(0);
+            sum_Iyy += dI(1) * dI(1);
+            sum_Ixy += dI(0) * dI(1);
+        }
+    }
+
+    sum_Ixx /= 9;
+    sum_Iyy /= 9;
+    sum_Ixy /= 9;
+
+    const float det = sum_Ixx * sum_Iyy - sum_Ixy * sum_Ixy;
+    const float trace = sum_Ixx + sum_Iyy;
+    return det - lambda * trace*trace;
+}
+
+}
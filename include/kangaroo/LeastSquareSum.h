@@ -85,4 +85,61 @@ struct SumLeastSquaresSystem
     }
 };
 
+///////////////////////////////////////////
+// As above, for any summable T with SetZero() and operator+ / +=,
+// such as statistics gathered alongside a LeastSquaresSystem.
+///////////////////////////////////////////
+
+template<typename T>
+struct HostSumBlocks
+{
+    Image<T> dSum;
+
+    __host__ HostSumBlocks(Image<unsigned char>& dWorkspace, dim3 blockDim, dim3 gridDim)
+    {
+        dSum = dWorkspace.PackedImage<T>(gridDim.x, gridDim.y);
+    }
+
+    __host__ inline Image<T>& SumImage()
+    {
+        return dSum;
+    }
+
+    __host__ inline T FinalSum()
+    {
+        T sum;
+        sum.SetZero();
+        return thrust::reduce(dSum.begin(), dSum.end(), sum, thrust::plus<T>() );
+    }
+};
+
+template<typename T, unsigned MAX_BLOCK_X, unsigned MAX_BLOCK_Y>
+struct SumBlocks
+{
+    T sReduce[MAX_BLOCK_X * MAX_BLOCK_Y];
+
+    __device__ inline T& ZeroThisObs()
+    {
+        const unsigned int tid = threadIdx.y*blockDim.x + threadIdx.x;
+        sReduce[tid].SetZero();
+        return sReduce[tid];
+    }
+
+    __device__ inline void ReducePutBlock(Image<T>& dSum)
+    {
+        const unsigned int tid = threadIdx.y*blockDim.x + threadIdx.x;
+        const unsigned int bid = blockIdx.y*gridDim.x + blockIdx.x;
+        __syncthreads();
+        for(unsigned S=blockDim.y*blockDim.x/2;S>0; S>>=1)  {
+            if( tid < S ) {
+                sReduce[tid] += sReduce[tid+S];
+            }
+            __syncthreads();
+        }
+        if( tid == 0) {
+            dSum[bid] = sReduce[0];
+        }
+    }
+};
+
 }
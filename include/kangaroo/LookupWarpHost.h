@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/WarpLookup.h>
+#include <kangaroo/CameraModel.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host lookup generation and fixed point warp
+// CPU counterpart of cu_lookup_warp.cu. Each row of a warp gathers
+// WarpHostLanes source quads into local arrays before interpolating them,
+// so the fixed point arithmetic runs over contiguous lanes.
+//////////////////////////////////////////////////////
+
+const int WarpHostLanes = 16;
+
+// Host counterpart of CreateLookupTable in cu_lookup_warp.cu, clamped in
+// the same way. The ray for each row is evaluated once, then stepped along
+// the row.
+inline void CreateLookupTable(
+        Image<float2,TargetHost> lookup,
+        const CameraModel& cam, const ImageIntrinsics& K_new, const Mat<float,3,3>& R_on
+        )
+{
+    const Mat<float,3,3> H_on = LookupRayMatrix(K_new, R_on);
+    const float3 dr = make_float3(H_on(0,0), H_on(1,0), H_on(2,0));
+
+#pragma omp parallel for
+    for(int y=0; y < (int)lookup.h; ++y) {
+        const float3 r0 = make_float3(
+            H_on(0,1)*y + H_on(0,2), H_on(1,1)*y + H_on(1,2), H_on(2,1)*y + H_on(2,2)
+        );
+        float2* row = lookup.RowPtr(y);
+        for(int x=0; x < (int)lookup.w; ++x) {
+            row[x] = ClampLookup(
+                cam.Project(make_float3(r0.x + x*dr.x, r0.y + x*dr.y, r0.z + x*dr.z)),
+                lookup.w, lookup.h
+            );
+        }
+    }
+}
+
+inline void CreateLookupTable(Image<float2,TargetHost> lookup, const CameraModel& cam)
+{
+    CreateLookupTable(lookup, cam, cam.Intrinsics(), MatId<float,3>());
+}
+
+template<typename Management>
+inline void CreateFixedLookupTable(
+        Image<WarpLookup,TargetHost> fixed, const Image<float2,TargetHost,Management>& lookup, int in_w, int in_h
+        )
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)fixed.h; ++y) {
+        for(int x=0; x < (int)fixed.w; ++x) {
+            fixed(x,y) = MakeWarpLookup(lookup(x,y), in_w, in_h);
+        }
+    }
+}
+
+template<typename T, typename Management>
+inline void WarpRowHost(
+        T* out, const Image<T,TargetHost,Management>& in, const WarpLookup* lookup, int w
+        )
+{
+    for(int x0=0; x0 < w; x0 += WarpHostLanes) {
+        const int lanes = std::min(WarpHostLanes, w-x0);
+        T tl[WarpHostLanes], tr[WarpHostLanes], bl[WarpHostLanes], br[WarpHostLanes];
+        int wx[WarpHostLanes], wy[WarpHostLanes];
+
+        for(int l=0; l < lanes; ++l) {
+            const WarpLookup lu = lookup[x0+l];
+            const T* r0 = in.RowPtr(lu.y) + lu.x;
+            const T* r1 = in.RowPtr(lu.y+1) + lu.x;
+            tl[l] = r0[0];
+            tr[l] = r0[1];
+            bl[l] = r1[0];
+            br[l] = r1[1];
+            wx[l] = lu.wx;
+            wy[l] = lu.wy;
+        }
+
+        for(int l=0; l < lanes; ++l) {
+            out[x0+l] = WarpLerp(tl[l], tr[l], bl[l], br[l], wx[l], wy[l]);
+        }
+    }
+}
+
+template<typename T, typename ManagementIn, typename ManagementLookup>
+inline void Warp(
+        Image<T,TargetHost> out, const Image<T,TargetHost,ManagementIn>& in,
+        const Image<WarpLookup,TargetHost,ManagementLookup>& lookup
+        )
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        WarpRowHost(out.RowPtr(y), in, lookup.RowPtr(y), out.w);
+    }
+}
+
+// Rows of both images share one parallel loop.
+template<typename T, typename ManagementIn, typename ManagementLookup>
+inline void Warp(
+        Image<T,TargetHost> out_left, Image<T,TargetHost> out_right,
+        const Image<T,TargetHost,ManagementIn>& in_left, const Image<T,TargetHost,ManagementIn>& in_right,
+        const Image<WarpLookup,TargetHost,ManagementLookup>& lookup_left,
+        const Image<WarpLookup,TargetHost,ManagementLookup>& lookup_right
+        )
+{
+    const int h = out_left.h;
+#pragma omp parallel for
+    for(int r=0; r < 2*h; ++r) {
+        if(r < h) {
+            WarpRowHost(out_left.RowPtr(r), in_left, lookup_left.RowPtr(r), out_left.w);
+        }else{
+            WarpRowHost(out_right.RowPtr(r-h), in_right, lookup_right.RowPtr(r-h), out_right.w);
+        }
+    }
+}
+
+}
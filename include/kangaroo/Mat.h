@@ -571,6 +571,50 @@ LeastSquaresSystem<P,N> operator-(const LeastSquaresSystem<P,N>& lhs, const Leas
   return ret;
 }
 
+///////////////////////////////////////////
+// Small dense solve
+///////////////////////////////////////////
+
+// Solve A x = b by Cholesky decomposition of symmetric A.
+// Returns false if A is not positive definite.
+template<typename P, unsigned N>
+inline __device__ __host__
+bool CholeskySolve(const SymMat<P,N>& A, const Mat<P,N,1>& b, Mat<P,N,1>& x)
+{
+    // Lower triangular factor, packed as A
+    SymMat<P,N> L;
+    for( unsigned r=0; r<N; ++r ) {
+        for( unsigned c=0; c<=r; ++c ) {
+            P s = A.m[r*(r+1)/2 + c];
+            for( unsigned k=0; k<c; ++k )
+                s -= L.m[r*(r+1)/2 + k] * L.m[c*(c+1)/2 + k];
+            if( r == c ) {
+                if( !(s > 0) ) return false;
+                L.m[r*(r+1)/2 + c] = sqrt(s);
+            }else{
+                L.m[r*(r+1)/2 + c] = s / L.m[c*(c+1)/2 + c];
+            }
+        }
+    }
+
+    // Forward substitution, L y = b
+    for( unsigned r=0; r<N; ++r ) {
+        P s = b(r);
+        for( unsigned k=0; k<r; ++k )
+            s -= L.m[r*(r+1)/2 + k] * x(k);
+        x(r) = s / L.m[r*(r+1)/2 + r];
+    }
+
+    // Back substitution, L^T x = y
+    for( int r=N-1; r>=0; --r ) {
+        P s = x(r);
+        for( unsigned k=r+1; k<N; ++k )
+            s -= L.m[k*(k+1)/2 + r] * x(k);
+        x(r) = s / L.m[r*(r+1)/2 + r];
+    }
+    return true;
+}
+
 ///////////////////////////////////////////
 // Vector project / unproject
 ///////////////////////////////////////////
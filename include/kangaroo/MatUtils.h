@@ -401,6 +401,48 @@ float3 SE3gen5mul(const float4& p) {
     return make_float3(-p.y,p.x,0);
 }
 
+//////////////////////////////////////////////////////
+// SE3 exponential of tangent x = (upsilon, omega),
+// matching Sophus::SE3::exp
+//////////////////////////////////////////////////////
+
+__host__ __device__ inline
+Mat<float,3,4> SE3exp(const Mat<float,6>& x)
+{
+    const float wx = x(3), wy = x(4), wz = x(5);
+    const float th2 = wx*wx + wy*wy + wz*wz;
+    const float th = sqrtf(th2);
+
+    // R = I + A W + B W^2, V = I + B W + C W^2
+    float A, B, C;
+    if(th < 1E-4f) {
+        A = 1.0f - th2/6.0f;
+        B = 0.5f - th2/24.0f;
+        C = 1.0f/6.0f - th2/120.0f;
+    }else{
+        A = sinf(th) / th;
+        B = (1.0f - cosf(th)) / th2;
+        C = (1.0f - A) / th2;
+    }
+
+    Mat<float,3,3> W;
+    W(0,0) = 0;   W(0,1) = -wz; W(0,2) = wy;
+    W(1,0) = wz;  W(1,1) = 0;   W(1,2) = -wx;
+    W(2,0) = -wy; W(2,1) = wx;  W(2,2) = 0;
+    const Mat<float,3,3> W2 = W * W;
+
+    Mat<float,3,4> T;
+    for(int r=0; r<3; ++r) {
+        T(r,3) = 0;
+        for(int c=0; c<3; ++c) {
+            const float id = r == c ? 1.0f : 0.0f;
+            T(r,c) = id + A*W(r,c) + B*W2(r,c);
+            T(r,3) += (id + B*W(r,c) + C*W2(r,c)) * x(c);
+        }
+    }
+    return T;
+}
+
 //////////////////////////////////////////////////////
 // Mat of float3
 //////////////////////////////////////////////////////
@@ -515,6 +557,115 @@ float L1(float4 val)
     return fabs(val.x) + fabs(val.y) + fabs(val.z) + fabs(val.w);
 }
 
+//////////////////////////////////////////////////////
+// Least squares plane fitting
+//////////////////////////////////////////////////////
+
+// Eigenvector of smallest eigenvalue lambda of symmetric 3x3 matrix
+// A = [a00 a01 a02; a01 a11 a12; a02 a12 a22].
+inline __host__ __device__
+void SmallestEigenvector(
+    double a00, double a01, double a02, double a11, double a12, double a22,
+    double& lambda, double v[3]
+) {
+    const double q = (a00 + a11 + a22) / 3.0;
+    const double p1 = a01*a01 + a02*a02 + a12*a12;
+    const double p2 = (a00-q)*(a00-q) + (a11-q)*(a11-q) + (a22-q)*(a22-q) + 2*p1;
+    const double p = sqrt(p2 / 6.0);
+
+    if(p < 1E-30) {
+        lambda = q;
+        v[0] = 0; v[1] = 0; v[2] = 1;
+        return;
+    }
+
+    // Eigenvalues q + 2p cos(phi + 2k pi/3), smallest for k = 1
+    const double b00 = (a00-q)/p, b11 = (a11-q)/p, b22 = (a22-q)/p;
+    const double b01 = a01/p, b02 = a02/p, b12 = a12/p;
+    const double r = 0.5 * ( b00*(b11*b22 - b12*b12) - b01*(b01*b22 - b12*b02) + b02*(b01*b12 - b11*b02) );
+    const double phi = acos( r <= -1 ? -1 : (r >= 1 ? 1 : r) ) / 3.0;
+    lambda = q + 2*p*cos(phi + 2.0943951023931957);
+
+    // Largest cross product of rows of A - lambda I
+    const double r0[3] = {a00 - lambda, a01, a02};
+    const double r1[3] = {a01, a11 - lambda, a12};
+    const double r2[3] = {a02, a12, a22 - lambda};
+    const double c[3][3] = {
+        {r0[1]*r1[2] - r0[2]*r1[1], r0[2]*r1[0] - r0[0]*r1[2], r0[0]*r1[1] - r0[1]*r1[0]},
+        {r0[1]*r2[2] - r0[2]*r2[1], r0[2]*r2[0] - r0[0]*r2[2], r0[0]*r2[1] - r0[1]*r2[0]},
+        {r1[1]*r2[2] - r1[2]*r2[1], r1[2]*r2[0] - r1[0]*r2[2], r1[0]*r2[1] - r1[1]*r2[0]}
+    };
+    int best = 0;
+    double best_sq = 0;
+    for(int i=0; i < 3; ++i) {
+        const double sq = c[i][0]*c[i][0] + c[i][1]*c[i][1] + c[i][2]*c[i][2];
+        if(sq > best_sq) {
+            best = i;
+            best_sq = sq;
+        }
+    }
+    const double norm = sqrt(best_sq);
+    for(int i=0; i < 3; ++i) {
+        v[i] = best_sq > 0 ? c[best][i] / norm : (i == 2);
+    }
+}
+
+// First and second moments of a set of points, for least squares plane
+// fitting. Sets are merged by adding their moments.
+struct PlaneMoments
+{
+    inline __host__ __device__
+    void SetZero() {
+        n = 0;
+        for(int i=0; i < 3; ++i) s[i] = 0;
+        for(int i=0; i < 6; ++i) ss[i] = 0;
+    }
+
+    inline __host__ __device__
+    void Add(const float4& P) {
+        // Products in double, as Fit subtracts nearly equal moments.
+        const double x = P.x, y = P.y, z = P.z;
+        n += 1;
+        s[0] += x;  s[1] += y;  s[2] += z;
+        ss[0] += x*x;  ss[1] += x*y;  ss[2] += x*z;
+        ss[3] += y*y;  ss[4] += y*z;  ss[5] += z*z;
+    }
+
+    inline __host__ __device__
+    void operator+=(const PlaneMoments& rhs)
+    {
+        n += rhs.n;
+        for(int i=0; i < 3; ++i) s[i] += rhs.s[i];
+        for(int i=0; i < 6; ++i) ss[i] += rhs.ss[i];
+    }
+
+    inline __host__ __device__
+    double MeanDepth() const {
+        return s[2] / n;
+    }
+
+    // Least squares plane n.P + d = 0 as (n.x, n.y, n.z, d), with |n| = 1
+    // and n facing the origin, and mean squared distance of points to it.
+    inline __host__ __device__
+    float4 Fit(double& mse) const {
+        const double mx = s[0]/n, my = s[1]/n, mz = s[2]/n;
+        double v[3];
+        SmallestEigenvector(
+            ss[0]/n - mx*mx, ss[1]/n - mx*my, ss[2]/n - mx*mz,
+            ss[3]/n - my*my, ss[4]/n - my*mz, ss[5]/n - mz*mz,
+            mse, v
+        );
+        mse = mse > 0 ? mse : 0;
+        const double d = -(v[0]*mx + v[1]*my + v[2]*mz);
+        const double sgn = d < 0 ? -1 : 1;
+        return make_float4(sgn*v[0], sgn*v[1], sgn*v[2], sgn*d);
+    }
+
+    double n;
+    double s[3];
+    double ss[6];
+};
+
 #ifdef USE_EIGEN
 inline __host__
 Eigen::Vector3d ToEigen(const float3 v)
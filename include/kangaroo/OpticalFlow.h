@@ -0,0 +1,97 @@
+#pragma once
+
+#include <kangaroo/Image.h>
+#include <kangaroo/Divergence.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// TV-L1 optical flow, per pixel operations
+// Zach, Pock and Bischof's duality based scheme, shared by host and device.
+// The data term is linearised about the current warp u0. The thresholding
+// step then solves the pointwise data problem for v, u = v + theta div p,
+// and p takes a projected dual ascent step for each flow component.
+//////////////////////////////////////////////////////
+
+// (I1(x+u0), dI1/dx, dI1/dy, rho0) such that rho(u) = rho0 + grad I1 . u
+// approximates I1(x+u) - I0(x). Zero gradient outside of I1.
+template<typename Target, typename Management>
+inline __host__ __device__
+float4 TVL1LineariseData(
+    const Image<float,Target,Management>& img0, const Image<float,Target,Management>& img1,
+    float2 u0, int x, int y
+) {
+    const float i0 = img0(x,y);
+    const float2 q = make_float2(x + u0.x, y + u0.y);
+    if( img1.InBounds(q.x, q.y, 2) ) {
+        const float i1 = img1.template GetBilinear<float>(q.x, q.y);
+        const Mat<float,1,2> dI = img1.template GetCentralDiff<float>(q.x, q.y);
+        return make_float4(i1, dI(0), dI(1), i1 - dI(0)*u0.x - dI(1)*u0.y - i0);
+    }
+    return make_float4(i0, 0, 0, 0);
+}
+
+// Minimise lambda |rho(v)| + |v - u|^2 / (2 theta) pointwise
+inline __host__ __device__
+float2 TVL1Threshold(const float4 data, const float2 u, float lambda_theta)
+{
+    const float2 g = make_float2(data.y, data.z);
+    const float g2 = g.x*g.x + g.y*g.y;
+    const float rho = data.w + g.x*u.x + g.y*u.y;
+
+    if( rho < -lambda_theta*g2 ) {
+        return u + lambda_theta*g;
+    }else if( rho > lambda_theta*g2 ) {
+        return u - lambda_theta*g;
+    }else if( g2 > 1E-10f ) {
+        return u - (rho/g2)*g;
+    }
+    return u;
+}
+
+template<typename Target, typename Management>
+inline __host__ __device__
+void TVL1PrimalUpdate(
+    Image<float,Target,Management> imgu1, Image<float,Target,Management> imgu2,
+    const Image<float2,Target,Management>& imgp1, const Image<float2,Target,Management>& imgp2,
+    const Image<float4,Target,Management>& imgdata,
+    float lambda, float theta, int x, int y
+) {
+    const float2 v = TVL1Threshold(imgdata(x,y), make_float2(imgu1(x,y), imgu2(x,y)), lambda*theta);
+    imgu1(x,y) = v.x + theta * DivA(imgp1, x, y);
+    imgu2(x,y) = v.y + theta * DivA(imgp2, x, y);
+}
+
+template<typename Target, typename Management>
+inline __host__ __device__
+void TVL1DualUpdate(
+    Image<float2,Target,Management> imgp1, Image<float2,Target,Management> imgp2,
+    const Image<float,Target,Management>& imgu1, const Image<float,Target,Management>& imgu2,
+    float tau_theta, int x, int y
+) {
+    imgp1(x,y) = ProjectUnitBall( imgp1(x,y) + tau_theta * GradUFwd(imgu1, imgu1(x,y), x, y) );
+    imgp2(x,y) = ProjectUnitBall( imgp2(x,y) + tau_theta * GradUFwd(imgu2, imgu2(x,y), x, y) );
+}
+
+// Bilinear upsample of coarse level flow (doubled) and duals to (x,y).
+template<typename Target, typename Management>
+inline __host__ __device__
+void TVL1Upsample(
+    Image<float,Target,Management> imgu1, Image<float,Target,Management> imgu2,
+    Image<float2,Target,Management> imgp1, Image<float2,Target,Management> imgp2,
+    const Image<float,Target,Management>& imgu1c, const Image<float,Target,Management>& imgu2c,
+    const Image<float2,Target,Management>& imgp1c, const Image<float2,Target,Management>& imgp2c,
+    int x, int y
+) {
+    const float2 pc = make_float2(
+        clamp( (x+0.5f)/2.0f - 0.5f, 0.0f, imgu1c.w - 1.001f ),
+        clamp( (y+0.5f)/2.0f - 0.5f, 0.0f, imgu1c.h - 1.001f )
+    );
+    imgu1(x,y) = 2.0f * imgu1c.template GetBilinear<float>(pc);
+    imgu2(x,y) = 2.0f * imgu2c.template GetBilinear<float>(pc);
+    imgp1(x,y) = ProjectUnitBall( imgp1c.template GetBilinear<float2>(pc) );
+    imgp2(x,y) = ProjectUnitBall( imgp2c.template GetBilinear<float2>(pc) );
+}
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/OpticalFlow.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host TV-L1 optical flow
+// CPU counterpart of TVL1OpticalFlow in cu_optical_flow.cu, using the same
+// per pixel operations from OpticalFlow.h so results agree to rounding.
+// Each pass updates all rows in parallel.
+//////////////////////////////////////////////////////
+
+struct TVL1HostLevel
+{
+    void Init(int w, int h)
+    {
+        i0buf.assign(w*h, 0.0f);
+        i1buf.assign(w*h, 0.0f);
+        u1buf.assign(w*h, 0.0f);
+        u2buf.assign(w*h, 0.0f);
+        p1buf.assign(w*h, make_float2(0,0));
+        p2buf.assign(w*h, make_float2(0,0));
+        databuf.assign(w*h, make_float4(0,0,0,0));
+        i0 = Image<float,TargetHost>(&i0buf[0], w, h, w*sizeof(float));
+        i1 = Image<float,TargetHost>(&i1buf[0], w, h, w*sizeof(float));
+        u1 = Image<float,TargetHost>(&u1buf[0], w, h, w*sizeof(float));
+        u2 = Image<float,TargetHost>(&u2buf[0], w, h, w*sizeof(float));
+        p1 = Image<float2,TargetHost>(&p1buf[0], w, h, w*sizeof(float2));
+        p2 = Image<float2,TargetHost>(&p2buf[0], w, h, w*sizeof(float2));
+        data = Image<float4,TargetHost>(&databuf[0], w, h, w*sizeof(float4));
+    }
+
+    std::vector<float> i0buf, i1buf, u1buf, u2buf;
+    std::vector<float2> p1buf, p2buf;
+    std::vector<float4> databuf;
+    Image<float,TargetHost> i0, i1, u1, u2;
+    Image<float2,TargetHost> p1, p2;
+    Image<float4,TargetHost> data;
+};
+
+template<typename Management>
+inline void TVL1BoxHalfHost(Image<float,TargetHost> out, const Image<float,TargetHost,Management>& in)
+{
+#pragma omp parallel for
+    for(int y=0; y < (int)out.h; ++y) {
+        for(int x=0; x < (int)out.w; ++x) {
+            out(x,y) = ( in(2*x,2*y) + in(2*x+1,2*y) + in(2*x,2*y+1) + in(2*x+1,2*y+1) ) / 4.0f;
+        }
+    }
+}
+
+template<unsigned Levels, typename Management>
+inline void TVL1OpticalFlow(
+        Image<float2,TargetHost> flow,
+        const Image<float,TargetHost,Management>& img0, const Image<float,TargetHost,Management>& img1,
+        float lambda = 0.15f, float theta = 0.3f, float tau = 0.25f,
+        int warps = 5, int its_per_warp = 20
+        )
+{
+    TVL1HostLevel lvl[Levels];
+    for(unsigned l=0; l < Levels; ++l) {
+        lvl[l].Init(img0.w >> l, img0.h >> l);
+        if(l == 0) {
+            for(int y=0; y < (int)img0.h; ++y) {
+                for(int x=0; x < (int)img0.w; ++x) {
+                    lvl[0].i0(x,y) = img0(x,y);
+                    lvl[0].i1(x,y) = img1(x,y);
+                }
+            }
+        }else{
+            TVL1BoxHalfHost(lvl[l].i0, lvl[l-1].i0);
+            TVL1BoxHalfHost(lvl[l].i1, lvl[l-1].i1);
+        }
+    }
+
+    for(int l=Levels-1; l >= 0; --l) {
+        TVL1HostLevel& L = lvl[l];
+        const int w = L.u1.w;
+        const int h = L.u1.h;
+
+        for(int k=0; k < warps; ++k) {
+#pragma omp parallel for
+            for(int y=0; y < h; ++y) {
+                for(int x=0; x < w; ++x) {
+                    L.data(x,y) = TVL1LineariseData(L.i0, L.i1, make_float2(L.u1(x,y), L.u2(x,y)), x, y);
+                }
+            }
+
+            for(int i=0; i < its_per_warp; ++i) {
+#pragma omp parallel for
+                for(int y=0; y < h; ++y) {
+                    for(int x=0; x < w; ++x) {
+                        TVL1PrimalUpdate(L.u1, L.u2, L.p1, L.p2, L.data, lambda, theta, x, y);
+                    }
+                }
+#pragma omp parallel for
+                for(int y=0; y < h; ++y) {
+                    for(int x=0; x < w; ++x) {
+                        TVL1DualUpdate(L.p1, L.p2, L.u1, L.u2, tau / theta, x, y);
+                    }
+                }
+            }
+        }
+
+        if(l > 0) {
+            TVL1HostLevel& F = lvl[l-1];
+#pragma omp parallel for
+            for(int y=0; y < (int)F.u1.h; ++y) {
+                for(int x=0; x < (int)F.u1.w; ++x) {
+                    TVL1Upsample(F.u1, F.u2, F.p1, F.p2, L.u1, L.u2, L.p1, L.p2, x, y);
+                }
+            }
+        }
+    }
+
+    for(int y=0; y < (int)flow.h; ++y) {
+        for(int x=0; x < (int)flow.w; ++x) {
+            flow(x,y) = make_float2(lvl[0].u1(x,y), lvl[0].u2(x,y));
+        }
+    }
+}
+
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Mat.h>
+#include <kangaroo/MatUtils.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/BoundedVolume.h>
+#include <kangaroo/ImageIntrinsics.h>
+#include <kangaroo/Sdf.h>
+#include <kangaroo/pixel_convert.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host Truncated SDF Fusion
+// CPU counterpart of SdfFuse in cu_sdffusion.cu. Voxel positions along an
+// x-row are stepped incrementally rather than transformed one by one, and
+// SdfHostLanes of them are projected before any depth is read. z-slices
+// update disjoint voxels, so they are fused in parallel.
+//////////////////////////////////////////////////////
+
+const int SdfHostLanes = 8;
+
+template<bool Color>
+inline void SdfFuseHostRows(
+        BoundedVolume<SDF_t,TargetHost> vol, BoundedVolume<float,TargetHost> colorVol,
+        Image<float,TargetHost> depth, Image<float4,TargetHost> normals, Mat<float,3,4> T_cw, ImageIntrinsics K,
+        Image<uchar3,TargetHost> img, Mat<float,3,4> T_iw, ImageIntrinsics Kimg,
+        float trunc_dist, float max_w, float mincostheta
+        )
+{
+    // Step in world and camera frames for a one voxel increment in x.
+    const float3 dP_w = vol.VoxelPositionInUnits(1,0,0) - vol.VoxelPositionInUnits(0,0,0);
+    const float3 dP_c = make_float3(T_cw(0,0), T_cw(1,0), T_cw(2,0)) * dP_w.x;
+    const float3 dP_i = make_float3(T_iw(0,0), T_iw(1,0), T_iw(2,0)) * dP_w.x;
+
+    const int w = vol.w;
+    const int h = vol.h;
+    const int d = vol.d;
+
+#pragma omp parallel for
+    for(int z=0; z < d; ++z) {
+        for(int y=0; y < h; ++y) {
+            const float3 P_w0 = vol.VoxelPositionInUnits(0,y,z);
+            const float3 P_c0 = T_cw * P_w0;
+            const float3 P_i0 = T_iw * P_w0;
+
+            for(int x0=0; x0 < w; x0 += SdfHostLanes) {
+                float cx[SdfHostLanes], cy[SdfHostLanes], cz[SdfHostLanes];
+                float u[SdfHostLanes], v[SdfHostLanes];
+
+                for(int l=0; l < SdfHostLanes; ++l) {
+                    const float xf = (float)(x0 + l);
+                    cx[l] = P_c0.x + xf * dP_c.x;
+                    cy[l] = P_c0.y + xf * dP_c.y;
+                    cz[l] = P_c0.z + xf * dP_c.z;
+                }
+
+                for(int l=0; l < SdfHostLanes; ++l) {
+                    u[l] = K.u0 + K.fu * cx[l] / cz[l];
+                    v[l] = K.v0 + K.fv * cy[l] / cz[l];
+                }
+
+                const int lanes = std::min(SdfHostLanes, w - x0);
+                for(int l=0; l < lanes; ++l) {
+                    const float2 p_c = make_float2(u[l], v[l]);
+                    if( !depth.InBounds(p_c, 2) ) continue;
+
+                    const int x = x0 + l;
+                    const float3 P_c = make_float3(cx[l], cy[l], cz[l]);
+
+                    float c = 0;
+                    if(Color) {
+                        const float3 P_i = P_i0 + (float)x * dP_i;
+                        const float2 p_i = Kimg.Project(P_i);
+                        if( !img.InBounds(p_i, 2) ) continue;
+                        c = ConvertPixel<float,float3>( img.template GetBilinear<float3>(p_i) ) / 255.0f;
+                    }
+
+                    const float vd = P_c.z;
+                    const float md = depth.template GetBilinear<float>(p_c);
+                    const float3 mdn = make_float3(normals.template GetBilinear<float4>(p_c));
+
+                    const float costheta = dot(mdn, P_c) / -length(P_c);
+                    const float sd = costheta * (md - vd);
+                    const float wt = costheta * 1.0f/vd;
+
+                    if(sd > -trunc_dist && std::isfinite(md) && std::isfinite(wt) && costheta > mincostheta ) {
+                        const SDF_t curvol = vol(x,y,z);
+                        SDF_t sdf( clamp(sd,-trunc_dist,trunc_dist) , wt);
+                        sdf += curvol;
+                        sdf.LimitWeight(max_w);
+                        vol(x,y,z) = sdf;
+                        if(Color) {
+                            colorVol(x,y,z) = (wt*c + colorVol(x,y,z) * curvol.w) / (wt + curvol.w);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+inline void SdfFuse(BoundedVolume<SDF_t,TargetHost> vol, Image<float,TargetHost> depth, Image<float4,TargetHost> norm, Mat<float,3,4> T_cw, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta )
+{
+    SdfFuseHostRows<false>(vol, BoundedVolume<float,TargetHost>(), depth, norm, T_cw, K, Image<uchar3,TargetHost>(), T_cw, K, trunc_dist, max_w, mincostheta);
+}
+
+inline void SdfFuse(
+        BoundedVolume<SDF_t,TargetHost> vol, BoundedVolume<float,TargetHost> colorVol,
+        Image<float,TargetHost> depth, Image<float4,TargetHost> norm, Mat<float,3,4> T_cw, ImageIntrinsics K,
+        Image<uchar3,TargetHost> img, Mat<float,3,4> T_iw, ImageIntrinsics Kimg,
+        float trunc_dist, float max_w, float mincostheta
+        )
+{
+    SdfFuseHostRows<true>(vol, colorVol, depth, norm, T_cw, K, img, T_iw, Kimg, trunc_dist, max_w, mincostheta);
+}
+
+//////////////////////////////////////////////////////
+// Host Batched Truncated SDF Fusion
+// CPU counterpart of the batched SdfFuse. Each lane of voxels keeps its
+// running mean across all frames and is written back once, so the result
+// matches N calls to the single-frame host SdfFuse.
+//////////////////////////////////////////////////////
+
+// Host image version of SdfDepthFrame. As there, fusion stops at the first
+// frame with null depth.ptr, which callers must set in unused slots.
+struct SdfDepthFrameHost
+{
+    Image<float,TargetHost> depth;
+    Image<float4,TargetHost> norm;
+    Mat<float,3,4> T_cw;
+};
+
+template<unsigned N>
+inline void SdfFuse(BoundedVolume<SDF_t,TargetHost> vol, const Mat<SdfDepthFrameHost,N>& frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta )
+{
+    int nf = 0;
+    while(nf < (int)N && frames[nf].depth.ptr) ++nf;
+    if(nf == 0) return;
+
+    // Step in world and in each camera frame for a one voxel increment in x.
+    const float3 dP_w = vol.VoxelPositionInUnits(1,0,0) - vol.VoxelPositionInUnits(0,0,0);
+    float3 dP_c[N];
+    for(int f=0; f < nf; ++f) {
+        const Mat<float,3,4>& T_cw = frames[f].T_cw;
+        dP_c[f] = make_float3(T_cw(0,0), T_cw(1,0), T_cw(2,0)) * dP_w.x;
+    }
+
+    const int w = vol.w;
+    const int h = vol.h;
+    const int d = vol.d;
+
+#pragma omp parallel for
+    for(int z=0; z < d; ++z) {
+        for(int y=0; y < h; ++y) {
+            const float3 P_w0 = vol.VoxelPositionInUnits(0,y,z);
+            float3 P_c0[N];
+            for(int f=0; f < nf; ++f) {
+                P_c0[f] = frames[f].T_cw * P_w0;
+            }
+
+            for(int x0=0; x0 < w; x0 += SdfHostLanes) {
+                const int lanes = std::min(SdfHostLanes, w - x0);
+
+                SDF_t curvol[SdfHostLanes];
+                bool updated[SdfHostLanes];
+                for(int l=0; l < lanes; ++l) {
+                    curvol[l] = vol(x0+l,y,z);
+                    updated[l] = false;
+                }
+
+                for(int f=0; f < nf; ++f) {
+                    const SdfDepthFrameHost& frame = frames[f];
+                    float cx[SdfHostLanes], cy[SdfHostLanes], cz[SdfHostLanes];
+                    float u[SdfHostLanes], v[SdfHostLanes];
+
+                    for(int l=0; l < SdfHostLanes; ++l) {
+                        const float xf = (float)(x0 + l);
+                        cx[l] = P_c0[f].x + xf * dP_c[f].x;
+                        cy[l] = P_c0[f].y + xf * dP_c[f].y;
+                        cz[l] = P_c0[f].z + xf * dP_c[f].z;
+                    }
+
+                    for(int l=0; l < SdfHostLanes; ++l) {
+                        u[l] = K.u0 + K.fu * cx[l] / cz[l];
+                        v[l] = K.v0 + K.fv * cy[l] / cz[l];
+                    }
+
+                    for(int l=0; l < lanes; ++l) {
+                        const float2 p_c = make_float2(u[l], v[l]);
+                        if( !frame.depth.InBounds(p_c, 2) ) continue;
+
+                        const float3 P_c = make_float3(cx[l], cy[l], cz[l]);
+                        const float vd = P_c.z;
+                        const float md = frame.depth.template GetBilinear<float>(p_c);
+                        const float3 mdn = make_float3(frame.norm.template GetBilinear<float4>(p_c));
+
+                        const float costheta = dot(mdn, P_c) / -length(P_c);
+                        const float sd = costheta * (md - vd);
+                        const float wt = costheta * 1.0f/vd;
+
+                        if(sd > -trunc_dist && std::isfinite(md) && std::isfinite(wt) && costheta > mincostheta ) {
+                            SDF_t sdf( clamp(sd,-trunc_dist,trunc_dist) , wt);
+                            sdf += curvol[l];
+                            sdf.LimitWeight(max_w);
+                            curvol[l] = sdf;
+                            updated[l] = true;
+                        }
+                    }
+                }
+
+                for(int l=0; l < lanes; ++l) {
+                    if(updated[l]) vol(x0+l,y,z) = curvol[l];
+                }
+            }
+        }
+    }
+}
+
+}
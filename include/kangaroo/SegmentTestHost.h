@@ -0,0 +1,149 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/Keypoint.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Host Keypoint Detection
+// CPU counterpart of DetectKeypoints in cu_segment_test.cu. For a run of
+// SegmentTestHostLanes pixels, each of the 16 circle offsets sets one bit of
+// the brighter and darker masks, read from a single shifted row, before the
+// arc test. Rows are scored in parallel.
+//////////////////////////////////////////////////////
+
+const int SegmentTestHostLanes = 16;
+
+template<typename Management>
+inline void KeypointScoresHost(
+        Image<float,TargetHost> scores, const Image<unsigned char,TargetHost,Management>& img,
+        int threshold, int arc_length, bool harris_score
+        )
+{
+    const int cx[16] = { 0, 1, 2, 3, 3, 3, 2, 1, 0,-1,-2,-3,-3,-3,-2,-1};
+    const int cy[16] = {-3,-3,-2,-1, 0, 1, 2, 3, 3, 3, 2, 1, 0,-1,-2,-3};
+
+    const int w = img.w;
+    const int h = img.h;
+
+#pragma omp parallel for
+    for(int y=3; y < h-3; ++y) {
+        const unsigned char* row = img.RowPtr(y);
+
+        for(int x0=3; x0 < w-3; x0 += SegmentTestHostLanes) {
+            const int lanes = std::min(SegmentTestHostLanes, w-3-x0);
+            int p[SegmentTestHostLanes];
+            unsigned int light[SegmentTestHostLanes], dark[SegmentTestHostLanes];
+            int sad_light[SegmentTestHostLanes], sad_dark[SegmentTestHostLanes];
+
+            for(int l=0; l < lanes; ++l) {
+                p[l] = row[x0+l];
+                light[l] = 0;
+                dark[l] = 0;
+                sad_light[l] = 0;
+                sad_dark[l] = 0;
+            }
+
+            for(int i=0; i < 16; ++i) {
+                const unsigned char* qrow = img.RowPtr(y+cy[i]) + x0 + cx[i];
+                for(int l=0; l < lanes; ++l) {
+                    const int q = qrow[l];
+                    const int dl = q - p[l] - threshold;
+                    const int dd = p[l] - q - threshold;
+                    light[l] |= (dl > 0) << i;
+                    dark[l]  |= (dd > 0) << i;
+                    sad_light[l] += std::max(dl, 0);
+                    sad_dark[l]  += std::max(dd, 0);
+                }
+            }
+
+            for(int l=0; l < lanes; ++l) {
+                const bool is_light = SegmentTestArc(light[l], arc_length);
+                const bool is_dark = SegmentTestArc(dark[l], arc_length);
+                float score = 0;
+                if(is_light || is_dark) {
+                    if(harris_score) {
+                        score = std::max(0.0f, HarrisResponse(img, x0+l, y, 0.04f));
+                    }else{
+                        score = std::max(is_light ? sad_light[l] : 0, is_dark ? sad_dark[l] : 0);
+                    }
+                }
+                scores(x0+l, y) = score;
+            }
+        }
+    }
+}
+
+// Order by descending score, ties in raster order, as KernKeypointBucket.
+inline bool KeypointBetter(const Keypoint& a, const Keypoint& b)
+{
+    return a.score > b.score || (a.score == b.score && (a.y < b.y || (a.y == b.y && a.x < b.x)));
+}
+
+template<unsigned Levels, typename Management>
+inline void DetectKeypoints(
+        std::vector<Keypoint>& keypoints, const Pyramid<unsigned char,Levels,TargetHost,Management>& pyr,
+        unsigned char threshold, unsigned char arc_length = 9, int cell_size = 32, int max_per_cell = 4, bool harris_score = true
+        )
+{
+    keypoints.clear();
+    std::vector<float> score_buffer;
+    std::vector<Keypoint> cand;
+
+    for(unsigned l=0; l < Levels; ++l) {
+        const Image<unsigned char,TargetHost,Management>& img = pyr.imgs[l];
+        const int w = img.w;
+        const int h = img.h;
+
+        score_buffer.assign(w*h, 0.0f);
+        Image<float,TargetHost> scores(&score_buffer[0], w, h, w*sizeof(float));
+        KeypointScoresHost(scores, img, threshold, arc_length, harris_score);
+
+        const float scale = 1 << l;
+        for(int y0=0; y0 < h; y0 += cell_size) {
+            for(int x0=0; x0 < w; x0 += cell_size) {
+                cand.clear();
+                for(int y=std::max(y0,1); y < std::min(y0+cell_size,h-1); ++y) {
+                    for(int x=std::max(x0,1); x < std::min(x0+cell_size,w-1); ++x) {
+                        const float s = scores(x,y);
+                        if(s <= 0) continue;
+
+                        // Strict 3x3 maximum, ties to first in raster order
+                        bool is_max = true;
+                        for(int sy=-1; sy<=1 && is_max; ++sy) {
+                            for(int sx=-1; sx<=1; ++sx) {
+                                const float q = scores(x+sx,y+sy);
+                                if( q > s || (q == s && (sy < 0 || (sy == 0 && sx < 0))) ) {
+                                    is_max = false;
+                                    break;
+                                }
+                            }
+                        }
+
+                        if(is_max) {
+                            cand.push_back( Keypoint(x, y, s, l) );
+                        }
+                    }
+                }
+
+                const int n = std::min((int)cand.size(), max_per_cell);
+                std::partial_sort(cand.begin(), cand.begin() + n, cand.end(), KeypointBetter);
+                for(int i=0; i < n; ++i) {
+                    Keypoint kp = cand[i];
+                    kp.x = (kp.x + 0.5f)*scale - 0.5f;
+                    kp.y = (kp.y + 0.5f)*scale - 0.5f;
+                    keypoints.push_back(kp);
+                }
+            }
+        }
+    }
+}
+
+}
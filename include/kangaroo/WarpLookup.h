@@ -0,0 +1,97 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+// Bilinear weights are fixed point with WarpLookupBits fractional bits.
+const int WarpLookupBits = 7;
+const int WarpLookupScale = 1 << WarpLookupBits;
+
+// Precomputed bilinear sample: top-left source pixel (x,y) and weights
+// wx, wy in [0,WarpLookupScale] of (x+1,y) and (x,y+1).
+struct WarpLookup
+{
+    short x;
+    short y;
+    unsigned char wx;
+    unsigned char wy;
+};
+
+// Clamp source position p to [1,w-2] x [1,h-2], the range CreateLookupTable
+// writes, so that bilinear samples around p stay within a w x h image.
+inline __device__ __host__
+float2 ClampLookup(float2 p, int w, int h)
+{
+    return make_float2(
+        fminf(fmaxf(p.x, 1.0f), w - 2.0f),
+        fminf(fmaxf(p.y, 1.0f), h - 2.0f)
+    );
+}
+
+// Fixed point sample of source position p within w x h image (w,h >= 2).
+// Positions outside are clamped to the border.
+inline __device__ __host__
+WarpLookup MakeWarpLookup(float2 p, int w, int h)
+{
+    const float sx = fminf(fmaxf(p.x, 0.0f), w - 1.0f);
+    const float sy = fminf(fmaxf(p.y, 0.0f), h - 1.0f);
+    WarpLookup l;
+    l.x = sx < w - 2 ? (int)sx : w - 2;
+    l.y = sy < h - 2 ? (int)sy : h - 2;
+    l.wx = (unsigned char)((sx - l.x) * WarpLookupScale + 0.5f);
+    l.wy = (unsigned char)((sy - l.y) * WarpLookupScale + 0.5f);
+    return l;
+}
+
+inline __device__ __host__
+unsigned char WarpLerp(unsigned char tl, unsigned char tr, unsigned char bl, unsigned char br, int wx, int wy)
+{
+    const int t = tl*(WarpLookupScale - wx) + tr*wx;
+    const int b = bl*(WarpLookupScale - wx) + br*wx;
+    return (t*(WarpLookupScale - wy) + b*wy + (1 << (2*WarpLookupBits-1))) >> (2*WarpLookupBits);
+}
+
+inline __device__ __host__
+uchar3 WarpLerp(uchar3 tl, uchar3 tr, uchar3 bl, uchar3 br, int wx, int wy)
+{
+    return make_uchar3(
+        WarpLerp(tl.x, tr.x, bl.x, br.x, wx, wy),
+        WarpLerp(tl.y, tr.y, bl.y, br.y, wx, wy),
+        WarpLerp(tl.z, tr.z, bl.z, br.z, wx, wy)
+    );
+}
+
+inline __device__ __host__
+uchar4 WarpLerp(uchar4 tl, uchar4 tr, uchar4 bl, uchar4 br, int wx, int wy)
+{
+    return make_uchar4(
+        WarpLerp(tl.x, tr.x, bl.x, br.x, wx, wy),
+        WarpLerp(tl.y, tr.y, bl.y, br.y, wx, wy),
+        WarpLerp(tl.z, tr.z, bl.z, br.z, wx, wy),
+        WarpLerp(tl.w, tr.w, bl.w, br.w, wx, wy)
+    );
+}
+
+inline __device__ __host__
+float WarpLerp(float tl, float tr, float bl, float br, int wx, int wy)
+{
+    const float fx = wx * (1.0f / WarpLookupScale);
+    const float fy = wy * (1.0f / WarpLookupScale);
+    const float t = tl + fx*(tr - tl);
+    const float b = bl + fx*(br - bl);
+    return t + fy*(b - t);
+}
+
+template<typename T, typename Target, typename Management>
+inline __device__ __host__
+T WarpSample(const Image<T,Target,Management>& in, const WarpLookup l)
+{
+    const T* r0 = in.RowPtr(l.y) + l.x;
+    const T* r1 = in.RowPtr(l.y+1) + l.x;
+    return WarpLerp(r0[0], r0[1], r1[0], r1[1], l.wx, l.wy);
+}
+
+}
@@ -18,4 +18,10 @@ template<typename Tout, typename Tin, unsigned MAXRAD, unsigned MAXIMGDIM>
 KANGAROO_EXPORT
 void GaussianBlur(Image<Tout> out, Image<Tin> in, Image<Tout> temp, float sigma);
 
+// Recursive (Young - van Vliet) Gaussian. Cost is independent of sigma.
+// sigma < 0.5 is clamped. dWorkspace must hold two w*h float images.
+template<typename Tout, typename Tin>
+KANGAROO_EXPORT
+void GaussianBlurRecursive(Image<Tout> out, Image<Tin> in, Image<unsigned char> dWorkspace, float sigma);
+
 }
@@ -2,6 +2,7 @@
 
 #include <kangaroo/platform.h>
 #include <kangaroo/Image.h>
+#include <kangaroo/ColourConvert.h>
 
 namespace roo
 {
@@ -10,4 +11,27 @@ template<typename To, typename Ti>
 KANGAROO_EXPORT
 void ConvertImage(Image<To> dOut, const Image<Ti> dIn);
 
+// Output types To for the conversions below are unsigned char or float
+// (BT.601 luma, float in [0,1]), uchar3, uchar4 or float4.
+
+// BT.601 luma of uchar3 or uchar4 image
+template<typename To, typename Ti>
+KANGAROO_EXPORT
+void ConvertRgbToGray(Image<To> dOut, const Image<Ti> dIn);
+
+// Packed YUYV 4:2:2, as dOut.w/2 x dOut.h image of (Y0,U,Y1,V)
+template<typename To>
+KANGAROO_EXPORT
+void ConvertYUYV(Image<To> dOut, const Image<uchar4> dIn);
+
+// NV12 4:2:0, as dOut.w x 3*dOut.h/2 image of Y plane then interleaved UV
+template<typename To>
+KANGAROO_EXPORT
+void ConvertNV12(Image<To> dOut, const Image<unsigned char> dIn);
+
+// Bilinear demosaic of raw Bayer image
+template<typename To>
+KANGAROO_EXPORT
+void DemosaicBayer(Image<To> dOut, const Image<unsigned char> dIn, BayerPattern pattern);
+
 }
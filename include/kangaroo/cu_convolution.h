@@ -2,6 +2,7 @@
 
 #include <kangaroo/platform.h>
 #include <kangaroo/Image.h>
+#include <kangaroo/Mat.h>
 
 namespace roo
 {
@@ -12,4 +13,20 @@ void Convolution(
     Image<OT> out,  Image<IT> in,  Image<KT> kern, int kx, int ky
 );
 
+// Separable convolution out = kcol^T (*) (krow (*) in), centred kernels of
+// radius RAD, Neumann boundary. Unlike Convolution the kernels are not
+// normalised, so derivative filters can be used. temp is size of in.
+// Requires RAD < in.w and RAD < in.h.
+template<typename OT, typename IT, unsigned RAD>
+KANGAROO_EXPORT
+void ConvolutionSeparable(
+    Image<OT> out, Image<IT> in, Image<float> temp,
+    const Mat<float,2*RAD+1> krow, const Mat<float,2*RAD+1> kcol
+);
+
+// Factor rank-1 kern into column and row vectors (kern(c,r) = kcol[r]*krow[c]).
+// Returns false if kern is not separable to within tol.
+KANGAROO_EXPORT
+bool SeparateKernel(const Image<float,TargetHost> kern, float* krow, float* kcol, float tol = 1E-5f);
+
 }
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/Mat.h>
+#include <kangaroo/Keypoint.h>
+
+namespace roo
+{
+
+// Oriented BRIEF: 256 intensity comparisons between fixed Gaussian
+// distributed point pairs about each keypoint at its pyramid level, rotated
+// by intensity centroid orientation if oriented is set. pyr should be
+// smoothed first (e.g. GaussianBlurRecursive with sigma 2).
+// Bits 0-127 are written to descriptors(i,0), bits 128-255 to descriptors(i,1).
+template<unsigned Levels>
+KANGAROO_EXPORT
+void BriefDescriptors(
+    Image<uint4> descriptors, const Image<Keypoint> keypoints, unsigned int num_keypoints,
+    const Pyramid<unsigned char,Levels> pyr, bool oriented = true
+);
+
+// Brute force Hamming distance match of each query descriptor against train
+// descriptors within max_radius pixels (max_radius <= 0 for all).
+// matches(i) = (train index, distance), with index -1 if the best exceeds
+// max_distance or isn't below ratio times the second best.
+KANGAROO_EXPORT
+void MatchDescriptors(
+    Image<int2> matches,
+    const Image<uint4> query_desc, const Image<Keypoint> query_kps, unsigned int num_query,
+    const Image<uint4> train_desc, const Image<Keypoint> train_kps, unsigned int num_train,
+    int max_distance, float ratio = 0.8f, float max_radius = 0
+);
+
+// As above, considering only train keypoints within max_epipolar_dist
+// pixels of the query keypoint's epipolar line F * (x, y, 1)^T.
+KANGAROO_EXPORT
+void MatchDescriptors(
+    Image<int2> matches,
+    const Image<uint4> query_desc, const Image<Keypoint> query_kps, unsigned int num_query,
+    const Image<uint4> train_desc, const Image<Keypoint> train_kps, unsigned int num_train,
+    const Mat<float,3,3> F, float max_epipolar_dist, int max_distance, float ratio = 0.8f
+);
+
+}
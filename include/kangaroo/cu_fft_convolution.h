@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cufft.h>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Convolution with cached FFT plans and kernel spectrum.
+// Matches Convolution<float,float,float,float> (normalised kernel,
+// Neumann boundary). Kernels with area above DirectMaxArea use real to
+// complex FFTs over a padded image, otherwise the direct path is used.
+// Use one plan per (image size, kernel) pair, e.g. A and A^T in
+// deconvolution share a plan via the adjoint flag. cuFFT failures throw
+// CudaException.
+//////////////////////////////////////////////////////
+
+class KANGAROO_EXPORT ConvolutionPlan
+{
+public:
+    static const int DirectMaxArea = 81;
+
+    ConvolutionPlan();
+    ~ConvolutionPlan();
+
+    // Cache kernel (origin kx,ky) for w x h images. FFT plans are reused
+    // if the padded size is unchanged.
+    void SetKernel(Image<float> kern, int kx, int ky, unsigned w, unsigned h);
+
+    // out = in (*) kern, or the adjoint operator (correlation with
+    // the flipped kernel) if adjoint is set.
+    void Convolve(Image<float> out, Image<float> in, bool adjoint = false);
+
+    bool UsesFft() const { return use_fft; }
+
+protected:
+    void ReleasePlan();
+
+    // Border needed either side for both the operator and its adjoint.
+    int PadX() const { return kx > (int)kern.w-1-kx ? kx : (int)kern.w-1-kx; }
+    int PadY() const { return ky > (int)kern.h-1-ky ? ky : (int)kern.h-1-ky; }
+
+    unsigned w, h;
+    unsigned W, H;
+    int kx, ky;
+    bool use_fft;
+
+    Image<float,TargetDevice,Manage> kern;
+    Image<float,TargetDevice,Manage> kernflip;
+
+    cufftHandle plan_r2c;
+    cufftHandle plan_c2r;
+    float* dPad;
+    cufftComplex* dSpec;
+    cufftComplex* dKernSpec;
+
+private:
+    // Owns device buffers and cuFFT plans, so not copyable.
+    ConvolutionPlan(const ConvolutionPlan&);
+    void operator=(const ConvolutionPlan&);
+};
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/Keypoint.h>
+
+namespace roo
+{
+
+// Pyramidal Lucas-Kanade tracking of keypoints from prev to next. Each
+// (2*win_rad+1)^2 window (win_rad <= 7) is tracked from the coarsest level
+// down. tracked(i) is the level 0 position in next, status(i) is 1 if the
+// track converged within bounds with mean absolute error below max_residual.
+template<unsigned Levels>
+KANGAROO_EXPORT
+void KltTrack(
+    Image<float2> tracked, Image<unsigned char> status,
+    const Image<Keypoint> keypoints, unsigned int num_keypoints,
+    const Pyramid<unsigned char,Levels> prev, const Pyramid<unsigned char,Levels> next,
+    int win_rad = 7, int max_its = 10, float eps = 0.01f, float max_residual = 20
+);
+
+}
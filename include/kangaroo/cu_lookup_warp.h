@@ -3,6 +3,8 @@
 #include <kangaroo/platform.h>
 #include <kangaroo/Mat.h>
 #include <kangaroo/Image.h>
+#include <kangaroo/WarpLookup.h>
+#include <kangaroo/CameraModel.h>
 
 namespace roo
 {
@@ -17,6 +19,23 @@ void CreateMatlabLookupTable(Image<float2> lookup,
     float fu, float fv, float u0, float v0, float k1, float k2, Mat<float,9> H_no
 );
 
+// Lookup from image of pinhole camera K_new, rotated by R_on with respect to
+// cam, into the original (distorted) image of cam. Use for undistortion and
+// rectification. The source image is assumed to be the size of lookup, and
+// positions are clamped to [1,w-2] x [1,h-2] (as CreateMatlabLookupTable),
+// so rays projecting outside it sample the border.
+KANGAROO_EXPORT
+void CreateLookupTable(Image<float2> lookup,
+    const CameraModel& cam, const ImageIntrinsics& K_new, const Mat<float,3,3> R_on
+);
+
+// Undistort lookup for cam, with K_new = cam.Intrinsics() if not given.
+KANGAROO_EXPORT
+void CreateLookupTable(Image<float2> lookup, const CameraModel& cam);
+
+KANGAROO_EXPORT
+void CreateLookupTable(Image<float2> lookup, const CameraModel& cam, const ImageIntrinsics& K_new);
+
 //////////////////////////////////////////////////////
 
 KANGAROO_EXPORT
@@ -24,4 +43,29 @@ void Warp(
     Image<unsigned char> out, const Image<unsigned char> in, const Image<float2> lookup
 );
 
+//////////////////////////////////////////////////////
+
+// Compile lookup of source positions within in_w x in_h images into fixed
+// point samples for the Warp overloads below.
+KANGAROO_EXPORT
+void CreateFixedLookupTable(
+    Image<WarpLookup> fixed, const Image<float2> lookup, int in_w, int in_h
+);
+
+// Warp using fixed point lookup. T is unsigned char, uchar3, uchar4 or float.
+template<typename T>
+KANGAROO_EXPORT
+void Warp(
+    Image<T> out, const Image<T> in, const Image<WarpLookup> lookup
+);
+
+// Warp (e.g. rectify) an equally sized stereo pair with a single launch.
+template<typename T>
+KANGAROO_EXPORT
+void Warp(
+    Image<T> out_left, Image<T> out_right,
+    const Image<T> in_left, const Image<T> in_right,
+    const Image<WarpLookup> lookup_left, const Image<WarpLookup> lookup_right
+);
+
 }
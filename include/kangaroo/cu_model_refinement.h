@@ -3,6 +3,9 @@
 #include <kangaroo/platform.h>
 #include <kangaroo/Mat.h>
 #include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/ImageIntrinsics.h>
+#include <kangaroo/reweighting.h>
 
 namespace roo
 {
@@ -63,6 +66,179 @@ LeastSquaresSystem<float,6> PoseRefinementProjectiveIcpPointPlane(
     Image<unsigned char> dWorkspace, Image<float4> dDebug
 );
 
+// Bins of width c/4 over |residual| in [0,2c), last bin also counting
+// everything beyond.
+const int IcpHistogramBins = 8;
+
+// Normal equations and tracking statistics from one ICP reduction.
+struct IcpStatistics
+{
+    inline __host__ __device__
+    void SetZero() {
+        lss.SetZero();
+        wSqErr = 0;
+        inliers = 0;
+        for(int i=0; i < IcpHistogramBins; ++i) hist[i] = 0;
+    }
+
+    inline __host__ __device__
+    void operator+=(const IcpStatistics& rhs)
+    {
+        lss += rhs.lss;
+        wSqErr += rhs.wSqErr;
+        inliers += rhs.inliers;
+        for(int i=0; i < IcpHistogramBins; ++i) hist[i] += rhs.hist[i];
+    }
+
+    // NaN when there are no observations
+    inline __host__
+    float Rmse() const {
+        return sqrtf(lss.sqErr / lss.obs);
+    }
+
+    inline __host__
+    float InlierRatio() const {
+        return lss.obs > 0 ? (float)inliers / lss.obs : 0.0f;
+    }
+
+    // JTJ scaled by inverse of residual variance estimated from weighted
+    // residuals, i.e. inverse covariance of pose increment.
+    inline __host__
+    Mat<float,6,6> Information() const {
+        const float sigma2 = lss.obs > 6 ? wSqErr / (lss.obs - 6) : 1.0f;
+        SymMat<float,6> info = lss.JTJ;
+        info *= 1.0f / (sigma2 > 0 ? sigma2 : 1.0f);
+        return info;
+    }
+
+    LeastSquaresSystem<float,6> lss;
+    float wSqErr;
+    unsigned inliers;
+    unsigned hist[IcpHistogramBins];
+};
+
+inline __host__ __device__
+IcpStatistics operator+(const IcpStatistics& lhs, const IcpStatistics& rhs)
+{
+    IcpStatistics ret = lhs;
+    ret += rhs;
+    return ret;
+}
+
+// Projective point-plane ICP with robust kernel Robust (RobustHuber,
+// RobustTukey, RobustCauchy or RobustSq from reweighting.h) of scale c.
+// Residuals with |r| <= c are counted as inliers.
+template<typename Robust>
+KANGAROO_EXPORT
+IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust(
+    const Image<float4> dPl,
+    const Image<float4> dPr, const Image<float4> dNr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl, float c,
+    Image<unsigned char> dWorkspace, Image<float4> dDebug
+);
+
+// Joint normal equations and per term statistics of
+// PoseRefinementProjectiveRgbd.
+struct RgbdStatistics
+{
+    inline __host__ __device__
+    void SetZero() {
+        lss.SetZero();
+        sqErrGeom = 0;
+        sqErrPhoto = 0;
+        obsGeom = 0;
+        obsPhoto = 0;
+    }
+
+    inline __host__ __device__
+    void operator+=(const RgbdStatistics& rhs)
+    {
+        lss += rhs.lss;
+        sqErrGeom += rhs.sqErrGeom;
+        sqErrPhoto += rhs.sqErrPhoto;
+        obsGeom += rhs.obsGeom;
+        obsPhoto += rhs.obsPhoto;
+    }
+
+    inline __host__
+    float RmseGeom() const {
+        return sqrtf(sqErrGeom / obsGeom);
+    }
+
+    inline __host__
+    float RmsePhoto() const {
+        return sqrtf(sqErrPhoto / obsPhoto);
+    }
+
+    LeastSquaresSystem<float,6> lss;
+    float sqErrGeom;
+    float sqErrPhoto;
+    unsigned obsGeom;
+    unsigned obsPhoto;
+};
+
+inline __host__ __device__
+RgbdStatistics operator+(const RgbdStatistics& lhs, const RgbdStatistics& rhs)
+{
+    RgbdStatistics ret = lhs;
+    ret += rhs;
+    return ret;
+}
+
+// Projective RGB-D alignment: point-plane residuals between dPl and
+// (dPr, dNr), and intensity residuals dIl(K T_lr Pr) - dIr, accumulated into
+// one system in a single pass over the reference images. Each term is
+// reweighted by Robust with scale c_geom / c_photo, and intensity terms are
+// further scaled by lambda_photo. Intensity terms don't require a live
+// point, so constrain the pose where geometry is degenerate (e.g. planes).
+template<typename Robust, typename Ti>
+KANGAROO_EXPORT
+RgbdStatistics PoseRefinementProjectiveRgbd(
+    const Image<float4> dPl, const Image<Ti> dIl,
+    const Image<float4> dPr, const Image<float4> dNr, const Image<Ti> dIr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl,
+    float c_geom, float c_photo, float lambda_photo,
+    Image<unsigned char> dWorkspace, Image<float4> dDebug
+);
+
+// Pose and statistics of IcpPointPlaneCoarseToFine, kept on device
+// between iterations.
+struct IcpState
+{
+    Mat<float,3,4> T_lr;
+    Mat<float,3,4> T_rl;
+
+    // Statistics of the last iteration performed
+    IcpStatistics stats;
+
+    // Total Gauss-Newton iterations performed
+    int its;
+
+    // Level at which the last step was below min_step (or the system was
+    // degenerate), -1 otherwise. Remaining iterations of a level are
+    // skipped once it converges, so done_level == 0 means converged.
+    int done_level;
+};
+
+// Coarse to fine projective point-plane ICP over pyramids of live points
+// dPl and reference points / normals dPr, dNr, starting from T_lr.
+// Performs its[l] Gauss-Newton iterations at level l, solving for
+// rotation only at the coarsest level when Levels > 1, with prior * I
+// added to JTJ. Each 6x6 system is reduced and solved on the device so
+// that the whole schedule runs without host synchronisation.
+// dWorkspace must hold an IcpState and one IcpStatistics per 16x16
+// block of dPr.imgs[0].
+// dDebug must be at least as large as dPr.imgs[0].
+template<unsigned Levels, typename Robust>
+KANGAROO_EXPORT
+IcpState IcpPointPlaneCoarseToFine(
+    const Pyramid<float4,Levels> dPl,
+    const Pyramid<float4,Levels> dPr, const Pyramid<float4,Levels> dNr,
+    const ImageIntrinsics K, const Mat<float,3,4> T_lr, const int its[Levels],
+    float c, float prior, Image<unsigned char> dWorkspace, Image<float4> dDebug,
+    float min_step = 1E-6f
+);
+
 KANGAROO_EXPORT
 LeastSquaresSystem<float,2*6> KinectCalibration(
     const Image<float4> dPl, const Image<uchar3> dIl,
@@ -9,4 +9,18 @@ namespace roo
 KANGAROO_EXPORT
 void NormalsFromVbo(Image<float4> dN, const Image<float4> dV);
 
+// Normals of dV from the covariance of valid points in a square window of
+// radius rad * z pixels (clamped to [1,max_rad]), shrunk until it spans no
+// depth discontinuity larger than max_depth_change * z between neighbouring
+// points. Window sums come from double precision integral images of points
+// and their outer products, so cost per pixel doesn't depend on window size.
+// Normals face the camera, with w = 1, or are zero where no window remains.
+// dWorkspace must hold thirteen double and one float image of size
+// (dV.w+1) x (dV.h+1).
+KANGAROO_EXPORT
+void NormalsFromVboIntegral(
+    Image<float4> dN, const Image<float4> dV, Image<unsigned char> dWorkspace,
+    float rad = 4.0f, int max_rad = 12, float max_depth_change = 0.02f
+);
+
 }
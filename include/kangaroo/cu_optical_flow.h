@@ -0,0 +1,25 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+// Coarse-to-fine TV-L1 optical flow such that img1(x + flow(x)) ~ img0(x),
+// for intensities in [0,255]. img0 and img1 are box reduced over Levels. On
+// each level the data term is linearised warps times about the current flow,
+// with its_per_warp primal / dual iterations per linearisation.
+// dWorkspace must hold 2 float, 2 float2 and a float4 image the size of
+// img0, plus 4 float and 2 float2 images for each coarser level.
+
+template<unsigned Levels>
+KANGAROO_EXPORT
+void TVL1OpticalFlow(
+    Image<float2> flow, const Image<float> img0, const Image<float> img1,
+    Image<unsigned char> dWorkspace,
+    float lambda = 0.15f, float theta = 0.3f, float tau = 0.25f,
+    int warps = 5, int its_per_warp = 20
+);
+
+}
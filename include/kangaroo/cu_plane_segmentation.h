@@ -0,0 +1,37 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/MatUtils.h>
+
+namespace roo
+{
+
+// Maximum distance of a point at depth z from its plane, dist_a z^2 + dist_b,
+// as used by SegmentPlanes.
+inline __host__ __device__
+float PlaneSegmentMaxDist(float z, float dist_a, float dist_b)
+{
+    return dist_a*z*z + dist_b;
+}
+
+// Segment dominant planes of organised point cloud dVbo (e.g. from
+// DepthToVbo). Planes are fit to block_size x block_size blocks without
+// missing points, and blocks within PlaneSegmentMaxDist (in RMS) of their
+// plane are merged agglomeratively with 4-connected neighbours whilst the
+// merged fit stays within it and normals agree to min_cos. Pixels of
+// blocks on plane boundaries are then reassigned to the nearest
+// neighbouring plane within PlaneSegmentMaxDist.
+// Writes planes supported by at least min_points points to dPlanes, largest
+// first, as in PlaneMoments::Fit, and each pixel's plane index to dLabels
+// (-1 for none). Returns number of planes written, at most dPlanes.w.
+// dWorkspace must hold a PlaneMoments and an int per block.
+KANGAROO_EXPORT
+unsigned int SegmentPlanes(
+    Image<int> dLabels, Image<float4> dPlanes, const Image<float4> dVbo,
+    Image<unsigned char> dWorkspace,
+    int block_size = 10, float dist_a = 1.6E-3f, float dist_b = 5E-3f,
+    float min_cos = 0.96f, unsigned int min_points = 3000
+);
+
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Fused primal-dual solver for Huber-ROF / TV-L2 denoising
+// min_u sum h_alpha(grad u) + lambda.w/2 (u-g)^2
+// alpha = 0 gives TV. imglambdaweight may be empty (null ptr), otherwise
+// lambda is scaled per pixel as in L2_u_minus_g_PrimalDescent (inpainting).
+//////////////////////////////////////////////////////
+
+// Run temporal_block (1,2 or 4) fused dual ascent / primal descent
+// iterations in a single tiled sweep from (uin,pin) into (uout,pout).
+// Input and output images must not alias.
+KANGAROO_EXPORT
+void HuberL2_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int temporal_block
+);
+
+// Primal-dual gap of (u,p), which bounds distance to optimal energy.
+KANGAROO_EXPORT
+float HuberL2_PrimalDualGap(
+        const Image<float> imgu, const Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float alpha, float lambda,
+        Image<unsigned char> dWorkspace
+);
+
+// Iterate from current (u,p) until gap per pixel < gap_tol or max_its.
+// Gap is evaluated every check_every iterations. dWorkspace must hold a
+// float and a float2 image the size of u, plus scratch for the gap sum.
+// Returns iterations performed.
+KANGAROO_EXPORT
+int HuberL2_PrimalDualSolve(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int max_its, float gap_tol, int check_every,
+        Image<unsigned char> dWorkspace
+);
+
+//////////////////////////////////////////////////////
+// Fused primal-dual solver for Huber-L1 / TV-L1 denoising
+// min_u sum h_alpha(grad u) + lambda.w |u-g|
+// As HuberL2 above, with the primal step replaced by soft thresholding
+// towards g. alpha = 0 gives TV-L1.
+//////////////////////////////////////////////////////
+
+KANGAROO_EXPORT
+void HuberL1_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int temporal_block
+);
+
+// Run its iterations from current (u,p). dWorkspace must hold a float and
+// a float2 image the size of u.
+KANGAROO_EXPORT
+void HuberL1_PrimalDualSolve(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int its, Image<unsigned char> dWorkspace
+);
+
+//////////////////////////////////////////////////////
+// Fused TGV-L1 denoising
+// Same iteration as TGV_L1_DenoisingIteration in cu_tgv.h, run
+// temporal_block (1,2 or 4) times per tiled sweep.
+//////////////////////////////////////////////////////
+
+// Input and output images must not alias.
+KANGAROO_EXPORT
+void TGV_L1_DenoisingSweep(
+        Image<float> uout, Image<float2> vout, Image<float2> pout, Image<float4> qout, Image<float> rout,
+        const Image<float> uin, const Image<float2> vin, const Image<float2> pin, const Image<float4> qin, const Image<float> rin,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta,
+        int temporal_block
+);
+
+// Run its iterations from current (u,v,p,q,r). dWorkspace must hold a
+// float, two float2, a float4 and a float image the size of u.
+KANGAROO_EXPORT
+void TGV_L1_DenoisingSolve(
+        Image<float> imgu, Image<float2> imgv,
+        Image<float2> imgp, Image<float4> imgq, Image<float> imgr,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta,
+        int its, Image<unsigned char> dWorkspace
+);
+
+//////////////////////////////////////////////////////
+// Coarse-to-fine warm start
+// g (and lambda weight) are box reduced over Levels. The problem is solved
+// on the coarsest level from u = g, p = 0, then u and p are upsampled as
+// the warm start for each finer level. lambda and alpha are doubled per
+// level to keep the regulariser / data balance of the fine grid.
+// imgu and imgp are overwritten. dWorkspace holds the reduced levels
+// followed by the HuberL2_PrimalDualSolve workspace.
+// Returns total iterations performed over all levels.
+//////////////////////////////////////////////////////
+
+template<unsigned Levels>
+KANGAROO_EXPORT
+int HuberL2_PrimalDualCoarseToFine(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int coarse_its, int fine_its, float gap_tol,
+        Image<unsigned char> dWorkspace
+);
+
+}
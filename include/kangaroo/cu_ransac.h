@@ -0,0 +1,85 @@
+#pragma once
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Mat.h>
+#include <kangaroo/Image.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// RANSAC initialisation for PlaneFitGN and ManhattanLineCost.
+// Hypotheses are drawn on the device from pseudo-random pixels and scored
+// RansacBatchSize at a time against every stride'th pixel in a single pass.
+// Batches stop once enough hypotheses have been scored to draw an all
+// inlier sample with the requested confidence, given the best inlier ratio
+// so far, or after max_hypotheses.
+//////////////////////////////////////////////////////
+
+const int RansacBatchSize = 32;
+
+template<typename T>
+struct RansacModel
+{
+    inline __host__
+    float InlierRatio() const {
+        return samples > 0 ? (float)inliers / samples : 0.0f;
+    }
+
+    T model;
+
+    // Inliers of model and valid pixels scored, at stride
+    unsigned inliers;
+    unsigned samples;
+
+    // Hypotheses scored
+    int hypotheses;
+};
+
+// Plane n.P + d = 0 with |n| = 1, as (n.x, n.y, n.z, d). Hypotheses are
+// formed from a single point and its normal. Points with zmin < P.z < zmax
+// are inliers when within max_dist of the plane and, if their normal is
+// valid, |n.N| > min_cos.
+KANGAROO_EXPORT
+RansacModel<float4> PlaneRansac(
+    const Image<float4> dVbo, const Image<float4> dNormals,
+    float zmin, float zmax, float max_dist, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses = 512, float confidence = 0.99f, int stride = 4, unsigned seed = 0
+);
+
+// Rotation whose rows are the Manhattan axes in the camera frame, as Rhat
+// of ManhattanLineCost. Hypotheses are formed from two roughly orthogonal
+// normals. Normals are inliers when |R N| along some axis exceeds min_cos.
+KANGAROO_EXPORT
+RansacModel<Mat<float,3,3> > ManhattanRansac(
+    const Image<float4> dNormals, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses = 512, float confidence = 0.99f, int stride = 4, unsigned seed = 0
+);
+
+// PlaneRansac followed by its iterations of PlaneFitGN with scale c, for
+// the plane Qinv * zhat. zhat is only overwritten if a plane not passing
+// through the origin was found.
+KANGAROO_EXPORT
+RansacModel<float4> PlaneFitRansacGN(
+    const Image<float4> dVbo, const Image<float4> dNormals,
+    const Mat<float,3,3> Qinv, Mat<float,3>& zhat,
+    Image<unsigned char> dWorkspace, Image<float> dErr,
+    float zmin, float zmax, float c, int its, float min_cos = 0.9f,
+    int max_hypotheses = 512, float confidence = 0.99f, int stride = 4, unsigned seed = 0
+);
+
+// ManhattanRansac followed by its iterations of ManhattanLineCost on image
+// in. Rhat is only overwritten if a hypothesis was found.
+KANGAROO_EXPORT
+RansacModel<Mat<float,3,3> > ManhattanRansacGN(
+    Image<float4> out, Image<float4> out2, const Image<unsigned char> in,
+    const Image<float4> dNormals, Mat<float,3,3>& Rhat,
+    float fu, float fv, float u0, float v0,
+    float cut, float scale, float min_grad, int its, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses = 512, float confidence = 0.99f, int stride = 4, unsigned seed = 0
+);
+
+}
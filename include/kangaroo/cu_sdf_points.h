@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+#include <kangaroo/platform.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/BoundedVolume.h>
+#include <kangaroo/Sdf.h>
+
+namespace roo
+{
+
+// Extract points on the zero level set of vol, one per voxel edge crossing.
+// pts, norms and colors are output buffers indexed linearly; norms and colors
+// may be empty (null ptr). colorVol is sampled only if valid.
+// dWorkspace must hold vol.w * vol.h unsigned ints.
+// Returns total number of crossings found, which may exceed pts.Area().
+KANGAROO_EXPORT
+unsigned int SdfSurfacePoints(Image<float4> pts, Image<float4> norms, Image<float> colors, BoundedVolume<SDF_t> vol, BoundedVolume<float> colorVol, Image<unsigned char> dWorkspace);
+
+// Write first num_points entries of device point buffers as binary PLY.
+KANGAROO_EXPORT
+void SavePointsPly(const std::string& filename, Image<float4> pts, Image<float4> norms, Image<float> colors, unsigned int num_points);
+
+}
@@ -10,12 +10,26 @@
 namespace roo
 {
 
+// Depth frame with its normals and pose, for batched fusion.
+// Fusion stops at the first frame with null depth.ptr. Mat does not
+// initialise its elements, so callers must null depth.ptr in unused slots.
+struct SdfDepthFrame
+{
+    Image<float> depth;
+    Image<float4> norm;
+    Mat<float,3,4> T_cw;
+};
+
 KANGAROO_EXPORT
 void SdfFuse(BoundedVolume<SDF_t> vol, Image<float> depth, Image<float4> norm, Mat<float,3,4> T_cw, ImageIntrinsics K, float trunc_dist, float maxw, float mincostheta );
 
 KANGAROO_EXPORT
 void SdfFuse(BoundedVolume<SDF_t> vol, BoundedVolume<float> colorVol, Image<float> depth, Image<float4> norm, Mat<float,3,4> T_cw, ImageIntrinsics K, Image<uchar3> img, Mat<float,3,4> T_iw, ImageIntrinsics Kimg,float trunc_dist, float max_w, float mincostheta);
 
+template<unsigned N>
+KANGAROO_EXPORT
+void SdfFuse(BoundedVolume<SDF_t> vol, const Mat<SdfDepthFrame,N> frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta);
+
 KANGAROO_EXPORT
 void SdfReset(BoundedVolume<SDF_t> vol, float trunc_dist);
 
@@ -2,6 +2,8 @@
 
 #include <kangaroo/platform.h>
 #include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/Keypoint.h>
 
 namespace roo
 {
@@ -19,4 +21,18 @@ void HarrisScore(
 KANGAROO_EXPORT
 void NonMaximalSuppression(Image<unsigned char> out, Image<float> scores, int rad, float threshold);
 
+// Detect FAST (arc_length of 16 segment test) corners over pyramid, scored
+// by Harris response or segment test SAD, and keep the best max_per_cell
+// 3x3 local maxima within each cell_size square cell of every level, ties
+// in raster order. max_per_cell is limited to 256.
+// Writes at most keypoints.w keypoints and returns number written.
+// dWorkspace must hold a level 0 float image plus max_per_cell Keypoints
+// for each level 0 cell.
+template<unsigned Levels>
+KANGAROO_EXPORT
+unsigned int DetectKeypoints(
+    Image<Keypoint> keypoints, const Pyramid<unsigned char,Levels> pyr, Image<unsigned char> dWorkspace,
+    unsigned char threshold, unsigned char arc_length = 9, int cell_size = 32, int max_per_cell = 4, bool harris_score = true
+);
+
 }
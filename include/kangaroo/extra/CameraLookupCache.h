@@ -0,0 +1,129 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <fstream>
+
+#include <kangaroo/Image.h>
+#include <kangaroo/CameraModel.h>
+#include <kangaroo/cu_lookup_warp.h>
+
+// Caches camera lookup tables keyed by camera model, new intrinsics,
+// rotation and resolution. Tables are kept in memory, and if dir is set,
+// saved to dir so they needn't be regenerated on the next run.
+class CameraLookupCache
+{
+public:
+    inline CameraLookupCache(const std::string& dir = "")
+        : m_dir(dir)
+    {
+    }
+
+    // Fill device lookup (as roo::CreateLookupTable) for its resolution.
+    // Returns true if the table came from the cache.
+    inline bool CreateLookupTable(
+        roo::Image<float2> dlookup,
+        const roo::CameraModel& cam, const roo::ImageIntrinsics& K_new, const roo::Mat<float,3,3>& R_on
+    ) {
+        const unsigned long long key = Key(cam, K_new, R_on, dlookup.w, dlookup.h);
+
+        std::map<unsigned long long, std::vector<float2> >::iterator it = m_tables.find(key);
+        if(it == m_tables.end()) {
+            std::vector<float2> table;
+            if(Load(key, dlookup.w, dlookup.h, table)) {
+                it = m_tables.insert(std::make_pair(key, table)).first;
+            }
+        }
+
+        if(it != m_tables.end()) {
+            dlookup.MemcpyFromHost(&it->second[0], dlookup.w*sizeof(float2));
+            return true;
+        }
+
+        roo::CreateLookupTable(dlookup, cam, K_new, R_on);
+        std::vector<float2>& table = m_tables[key];
+        table.resize(dlookup.w*dlookup.h);
+        roo::Image<float2,roo::TargetHost> htable(&table[0], dlookup.w, dlookup.h, dlookup.w*sizeof(float2));
+        htable.CopyFrom(dlookup);
+        Save(key, dlookup.w, dlookup.h, table);
+        return false;
+    }
+
+    inline bool CreateLookupTable(roo::Image<float2> dlookup, const roo::CameraModel& cam)
+    {
+        return CreateLookupTable(dlookup, cam, cam.Intrinsics(), roo::MatId<float,3>());
+    }
+
+    // FNV-1a hash of all parameters affecting the table
+    static inline unsigned long long Key(
+        const roo::CameraModel& cam, const roo::ImageIntrinsics& K_new, const roo::Mat<float,3,3>& R_on,
+        unsigned w, unsigned h
+    ) {
+        unsigned long long hash = 14695981039346656037ULL;
+        Hash(hash, &cam.type, sizeof(cam.type));
+        Hash(hash, &cam.fu, sizeof(float));
+        Hash(hash, &cam.fv, sizeof(float));
+        Hash(hash, &cam.u0, sizeof(float));
+        Hash(hash, &cam.v0, sizeof(float));
+        Hash(hash, cam.k, sizeof(cam.k));
+        Hash(hash, &K_new.fu, sizeof(float));
+        Hash(hash, &K_new.fv, sizeof(float));
+        Hash(hash, &K_new.u0, sizeof(float));
+        Hash(hash, &K_new.v0, sizeof(float));
+        Hash(hash, R_on.m, sizeof(R_on.m));
+        Hash(hash, &w, sizeof(w));
+        Hash(hash, &h, sizeof(h));
+        return hash;
+    }
+
+protected:
+    static inline void Hash(unsigned long long& hash, const void* data, size_t bytes)
+    {
+        const unsigned char* p = (const unsigned char*)data;
+        for(size_t i=0; i < bytes; ++i) {
+            hash = (hash ^ p[i]) * 1099511628211ULL;
+        }
+    }
+
+    inline std::string Filename(unsigned long long key) const
+    {
+        char name[32];
+        sprintf(name, "lookup_%016llx.bin", key);
+        return m_dir + "/" + name;
+    }
+
+    inline bool Load(unsigned long long key, unsigned w, unsigned h, std::vector<float2>& table) const
+    {
+        if(m_dir.empty()) return false;
+
+        std::ifstream f( Filename(key).c_str(), std::ios::in | std::ios::binary );
+        unsigned long long fkey = 0;
+        unsigned fw = 0, fh = 0;
+        f.read((char*)&fkey, sizeof(fkey));
+        f.read((char*)&fw, sizeof(fw));
+        f.read((char*)&fh, sizeof(fh));
+        if(!f.good() || fkey != key || fw != w || fh != h) {
+            return false;
+        }
+
+        table.resize(w*h);
+        f.read((char*)&table[0], w*h*sizeof(float2));
+        return f.good();
+    }
+
+    inline void Save(unsigned long long key, unsigned w, unsigned h, const std::vector<float2>& table) const
+    {
+        if(m_dir.empty()) return;
+
+        std::ofstream f( Filename(key).c_str(), std::ios::out | std::ios::binary );
+        f.write((const char*)&key, sizeof(key));
+        f.write((const char*)&w, sizeof(w));
+        f.write((const char*)&h, sizeof(h));
+        f.write((const char*)&table[0], w*h*sizeof(float2));
+    }
+
+    std::string m_dir;
+    std::map<unsigned long long, std::vector<float2> > m_tables;
+};
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include <Eigen/Eigen>
+#include <Eigen/Sparse>
+#include <sophus/se3.hpp>
+
+// SE3 pose graph over keyframe poses T_wk, solved natively by Gauss-Newton
+// with analytic Jacobians and sparse LDLT of the block normal equations.
+// Unlike PoseGraph, no per edge cost functions are allocated and no solver
+// thread is needed: edges can be added at any time, and Optimise only
+// relinearises keyframes touched since the last call and their neighbours
+// within a number of hops, holding the rest of the graph fixed. Symbolic
+// factorisation is cached on the sparsity pattern of the normal equations,
+// so it is reused whenever the active subgraph has the same shape, e.g. a
+// window sliding along a chain of keyframes.
+class IncrementalPoseGraph
+{
+public:
+    typedef Eigen::Matrix<double,6,1> Vector6d;
+    typedef Eigen::Matrix<double,6,6> Matrix6d;
+
+    // Relative pose measurement T_ba = T_wb^-1 * T_wa, or absolute
+    // measurement T_wb for unary edges (a < 0). Tangent order is Sophus'
+    // (translation, rotation), weighted by sqrt_info.
+    struct Edge
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        int b;
+        int a;
+        Sophus::SE3d T_ba;
+        Vector6d sqrt_info;
+    };
+
+    // cauchy_width > 0 robustifies edges (in units of weighted residual)
+    inline IncrementalPoseGraph(double cauchy_width = 0)
+        : m_cauchy_width(cauchy_width)
+    {
+    }
+
+    inline void Clear()
+    {
+        m_T_wk.clear();
+        m_free.clear();
+        m_vertex_edges.clear();
+        m_edges.clear();
+        m_dirty.clear();
+        m_pattern_outer.clear();
+        m_pattern_inner.clear();
+    }
+
+    inline int AddKeyframe(const Sophus::SE3d& T_wk = Sophus::SE3d())
+    {
+        const int k = m_T_wk.size();
+        m_T_wk.push_back(T_wk);
+        m_free.push_back(Vector6d::Ones());
+        m_vertex_edges.push_back(std::vector<int>());
+        m_dirty.push_back(k);
+        return k;
+    }
+
+    // New keyframe k, initialised and constrained relative to keyframe a
+    inline int AddRelativeKeyframe(int a, const Sophus::SE3d& T_ak)
+    {
+        const int k = AddKeyframe(m_T_wk[a] * T_ak);
+        AddBinaryEdge(a, k, T_ak);
+        return k;
+    }
+
+    inline void AddBinaryEdge(int b, int a, const Sophus::SE3d& T_ba, const Vector6d& sqrt_info = Vector6d::Ones())
+    {
+        assert(a < (int)m_T_wk.size() && b < (int)m_T_wk.size());
+        AddEdge(b, a, T_ba, sqrt_info);
+    }
+
+    inline void AddUnaryEdge(int a, const Sophus::SE3d& T_wa, const Vector6d& sqrt_info = Vector6d::Ones())
+    {
+        assert(a < (int)m_T_wk.size());
+        AddEdge(a, -1, T_wa, sqrt_info);
+    }
+
+    inline void SetKeyframeFreedom(int k, bool rot_free, bool trans_free)
+    {
+        m_free[k].head<3>().setConstant(trans_free ? 1 : 0);
+        m_free[k].tail<3>().setConstant(rot_free ? 1 : 0);
+        m_dirty.push_back(k);
+    }
+
+    inline const Sophus::SE3d& GetT_wk(int k) const
+    {
+        return m_T_wk[k];
+    }
+
+    inline void SetT_wk(int k, const Sophus::SE3d& T_wk)
+    {
+        m_T_wk[k] = T_wk;
+        m_dirty.push_back(k);
+    }
+
+    inline int NumKeyframes() const
+    {
+        return m_T_wk.size();
+    }
+
+    inline int NumEdges() const
+    {
+        return m_edges.size();
+    }
+
+    // Gauss-Newton over keyframes within hops edges of those touched since
+    // last call (all keyframes if hops < 0). Stops after max_its or once
+    // the update norm falls below tol. Returns cost over active edges.
+    inline double Optimise(int hops = 2, int max_its = 10, double tol = 1E-10)
+    {
+        SelectActive(hops);
+        m_dirty.clear();
+
+        const int n = m_active.size();
+        if(n == 0) return 0;
+
+        Eigen::VectorXd rhs(6*n);
+        std::vector<Eigen::Triplet<double> > triplets;
+
+        for(int it=0; it < max_its; ++it) {
+            triplets.clear();
+            rhs.setZero();
+
+            for(size_t i=0; i < m_active_edges.size(); ++i) {
+                const Edge& e = m_edges[m_active_edges[i]];
+                const int ib = m_active_idx[e.b];
+                const int ia = e.a >= 0 ? m_active_idx[e.a] : -1;
+
+                Vector6d r;
+                Matrix6d Jb, Ja;
+                Linearise(e, r, Jb, Ja);
+                Jb = Jb * m_free[e.b].asDiagonal();
+                if(e.a >= 0) Ja = Ja * m_free[e.a].asDiagonal();
+
+                double w;
+                RobustCost(r.squaredNorm(), w);
+
+                AddBlock(triplets, rhs, ib, ib, Jb, Jb, r, w);
+                if(ia >= 0) {
+                    AddBlock(triplets, rhs, ia, ia, Ja, Ja, r, w);
+                    if(ib >= 0) {
+                        AddBlock(triplets, rhs, ib, ia, Jb, Ja, r, w);
+                        AddBlock(triplets, rhs, ia, ib, Ja, Jb, r, w);
+                    }
+                }
+            }
+
+            // Identity for fixed dimensions, light damping for gauge freedom
+            for(int v=0; v < n; ++v) {
+                const Vector6d& f = m_free[m_active[v]];
+                for(int d=0; d < 6; ++d) {
+                    triplets.push_back( Eigen::Triplet<double>(6*v+d, 6*v+d, f(d) > 0 ? 1E-9 : 1.0) );
+                }
+            }
+
+            Eigen::SparseMatrix<double> H(6*n, 6*n);
+            H.setFromTriplets(triplets.begin(), triplets.end());
+
+            // Pattern is fixed over iterations
+            if(it == 0 && !SamePattern(H)) {
+                m_solver.analyzePattern(H);
+                m_pattern_outer.assign(H.outerIndexPtr(), H.outerIndexPtr() + H.outerSize() + 1);
+                m_pattern_inner.assign(H.innerIndexPtr(), H.innerIndexPtr() + H.nonZeros());
+            }
+            m_solver.factorize(H);
+            if(m_solver.info() != Eigen::Success) {
+                break;
+            }
+
+            const Eigen::VectorXd dx = m_solver.solve(-rhs);
+            for(int v=0; v < n; ++v) {
+                const int k = m_active[v];
+                m_T_wk[k] = m_T_wk[k] * Sophus::SE3d::exp( m_free[k].cwiseProduct(dx.segment<6>(6*v)) );
+            }
+
+            if(dx.norm() < tol) {
+                break;
+            }
+        }
+
+        return Cost();
+    }
+
+    inline double OptimiseAll(int max_its = 10, double tol = 1E-10)
+    {
+        return Optimise(-1, max_its, tol);
+    }
+
+    // Robust cost over active edges at current estimate
+    inline double Cost() const
+    {
+        double cost = 0;
+        for(size_t i=0; i < m_active_edges.size(); ++i) {
+            double w;
+            cost += RobustCost( Residual(m_edges[m_active_edges[i]]).squaredNorm(), w );
+        }
+        return cost;
+    }
+
+protected:
+    inline void AddEdge(int b, int a, const Sophus::SE3d& T_ba, const Vector6d& sqrt_info)
+    {
+        Edge e;
+        e.b = b;
+        e.a = a;
+        e.T_ba = T_ba;
+        e.sqrt_info = sqrt_info;
+
+        const int id = m_edges.size();
+        m_edges.push_back(e);
+        m_vertex_edges[b].push_back(id);
+        m_dirty.push_back(b);
+        if(a >= 0) {
+            m_vertex_edges[a].push_back(id);
+            m_dirty.push_back(a);
+        }
+    }
+
+    // Weighted residual log(T_ba_meas^-1 * T_wb^-1 * T_wa)
+    inline Vector6d Residual(const Edge& e) const
+    {
+        const Sophus::SE3d T_ba = e.a >= 0 ? m_T_wk[e.b].inverse() * m_T_wk[e.a] : m_T_wk[e.b];
+        return e.sqrt_info.cwiseProduct( (e.T_ba.inverse() * T_ba).log() );
+    }
+
+    // Jacobians with respect to right perturbation T_wk * exp(x), using
+    // first order approximation of inverse right Jacobian of SE3.
+    inline void Linearise(const Edge& e, Vector6d& r, Matrix6d& Jb, Matrix6d& Ja) const
+    {
+        const Sophus::SE3d T_ba = e.a >= 0 ? m_T_wk[e.b].inverse() * m_T_wk[e.a] : m_T_wk[e.b];
+        const Vector6d r_ = (e.T_ba.inverse() * T_ba).log();
+
+        Matrix6d adr = Matrix6d::Zero();
+        adr.block<3,3>(0,0) = Sophus::SO3d::hat(r_.tail<3>());
+        adr.block<3,3>(0,3) = Sophus::SO3d::hat(r_.head<3>());
+        adr.block<3,3>(3,3) = adr.block<3,3>(0,0);
+        const Matrix6d Jrinv = Matrix6d::Identity() + 0.5 * adr;
+
+        r = e.sqrt_info.cwiseProduct(r_);
+        if(e.a >= 0) {
+            Ja = e.sqrt_info.asDiagonal() * Jrinv;
+            Jb = -Ja * T_ba.inverse().Adj();
+        }else{
+            Jb = e.sqrt_info.asDiagonal() * Jrinv;
+            Ja.setZero();
+        }
+    }
+
+    // Cost of squared weighted residual s, and IRLS weight w
+    inline double RobustCost(double s, double& w) const
+    {
+        if(m_cauchy_width > 0) {
+            const double c2 = m_cauchy_width * m_cauchy_width;
+            w = 1.0 / (1.0 + s / c2);
+            return 0.5 * c2 * std::log(1.0 + s / c2);
+        }
+        w = 1.0;
+        return 0.5 * s;
+    }
+
+    static inline void AddBlock(
+        std::vector<Eigen::Triplet<double> >& triplets, Eigen::VectorXd& rhs,
+        int i, int j, const Matrix6d& Ji, const Matrix6d& Jj, const Vector6d& r, double w
+    ) {
+        if(i < 0) return;
+        const Matrix6d H = w * Ji.transpose() * Jj;
+        for(int c=0; c < 6; ++c) {
+            for(int rr=0; rr < 6; ++rr) {
+                triplets.push_back( Eigen::Triplet<double>(6*i+rr, 6*j+c, H(rr,c)) );
+            }
+        }
+        if(i == j) {
+            rhs.segment<6>(6*i) += w * Ji.transpose() * r;
+        }
+    }
+
+    // True if H has the sparsity pattern of the cached symbolic factorisation
+    inline bool SamePattern(const Eigen::SparseMatrix<double>& H) const
+    {
+        return (int)m_pattern_outer.size() == H.outerSize() + 1
+            && (int)m_pattern_inner.size() == H.nonZeros()
+            && std::equal(m_pattern_outer.begin(), m_pattern_outer.end(), H.outerIndexPtr())
+            && std::equal(m_pattern_inner.begin(), m_pattern_inner.end(), H.innerIndexPtr());
+    }
+
+    // Breadth first expansion of dirty keyframes, and the edges touching them
+    inline void SelectActive(int hops)
+    {
+        const int N = m_T_wk.size();
+        std::vector<int> active;
+        std::vector<int> active_idx(N, -1);
+
+        if(hops < 0) {
+            for(int k=0; k < N; ++k) {
+                active_idx[k] = active.size();
+                active.push_back(k);
+            }
+        }else{
+            for(size_t i=0; i < m_dirty.size(); ++i) {
+                const int k = m_dirty[i];
+                if(active_idx[k] < 0) {
+                    active_idx[k] = active.size();
+                    active.push_back(k);
+                }
+            }
+            size_t begin = 0;
+            for(int h=0; h < hops; ++h) {
+                const size_t end = active.size();
+                for(size_t i=begin; i < end; ++i) {
+                    const std::vector<int>& ve = m_vertex_edges[active[i]];
+                    for(size_t j=0; j < ve.size(); ++j) {
+                        const Edge& e = m_edges[ve[j]];
+                        const int o = e.b == active[i] ? e.a : e.b;
+                        if(o >= 0 && active_idx[o] < 0) {
+                            active_idx[o] = active.size();
+                            active.push_back(o);
+                        }
+                    }
+                }
+                begin = end;
+            }
+        }
+
+        std::vector<int> edges;
+        std::vector<bool> edge_used(m_edges.size(), false);
+        for(size_t i=0; i < active.size(); ++i) {
+            const std::vector<int>& ve = m_vertex_edges[active[i]];
+            for(size_t j=0; j < ve.size(); ++j) {
+                if(!edge_used[ve[j]]) {
+                    edge_used[ve[j]] = true;
+                    edges.push_back(ve[j]);
+                }
+            }
+        }
+
+        m_active.swap(active);
+        m_active_idx.swap(active_idx);
+        m_active_edges.swap(edges);
+    }
+
+    double m_cauchy_width;
+
+    std::vector<Sophus::SE3d, Eigen::aligned_allocator<Sophus::SE3d> > m_T_wk;
+    std::vector<Vector6d, Eigen::aligned_allocator<Vector6d> > m_free;
+    std::vector<std::vector<int> > m_vertex_edges;
+    std::vector<Edge, Eigen::aligned_allocator<Edge> > m_edges;
+    std::vector<int> m_dirty;
+
+    std::vector<int> m_active;
+    std::vector<int> m_active_idx;
+    std::vector<int> m_active_edges;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > m_solver;
+    std::vector<int> m_pattern_outer;
+    std::vector<int> m_pattern_inner;
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+
+#include <Eigen/Eigen>
+#include <sophus/se3.hpp>
+
+#include <kangaroo/Image.h>
+#include <kangaroo/Pyramid.h>
+#include <kangaroo/ImageIntrinsics.h>
+#include <kangaroo/cu_normals.h>
+#include <kangaroo/cu_model_refinement.h>
+
+// Device resident reference frame for dense tracking. Point and normal
+// pyramids are computed once, when the frame becomes a keyframe.
+template<unsigned Levels>
+struct DenseKeyframe
+{
+    inline DenseKeyframe(unsigned w, unsigned h)
+        : v(w,h), n(w,h), num_points(0)
+    {
+    }
+
+    roo::Pyramid<float4,Levels,roo::TargetDevice,roo::Manage> v;
+    roo::Pyramid<float4,Levels,roo::TargetDevice,roo::Manage> n;
+    Sophus::SE3d T_wk;
+
+    // Reference points with valid normals at level 0, to measure overlap
+    unsigned num_points;
+
+private:
+    DenseKeyframe(const DenseKeyframe&);
+    void operator=(const DenseKeyframe&);
+};
+
+// Keyframe based dense odometry. Frames are tracked against a cached
+// keyframe with IcpPointPlaneCoarseToFine rather than against the previous
+// frame, so only the live point pyramid is needed per frame and drift only
+// accumulates when keyframes change. When overlap with the active keyframe
+// falls below min_overlap, or motion from it exceeds max_translation /
+// max_rotation, the nearest cached keyframe within those thresholds is
+// reused, otherwise the live frame becomes a new keyframe, replacing the
+// cached keyframe furthest from it once max_keyframes are held.
+template<unsigned Levels>
+class KeyframeOdometry
+{
+public:
+    inline KeyframeOdometry(unsigned w, unsigned h, const roo::ImageIntrinsics& K, unsigned max_keyframes = 8)
+        : icp_c(0.02f), prior(0.5f), min_inlier_ratio(0.5f),
+          min_overlap(0.6f), max_translation(0.3f), max_rotation(0.3f),
+          m_w(w), m_h(h), m_K(K), m_max_keyframes(max_keyframes), m_active(-1),
+          m_workspace(w*sizeof(roo::LeastSquaresSystem<float,12>), h), m_debug(w,h)
+    {
+        for(unsigned l=0; l < Levels; ++l) {
+            its[l] = 3;
+        }
+    }
+
+    inline ~KeyframeOdometry()
+    {
+        Clear();
+    }
+
+    inline void Clear()
+    {
+        for(size_t k=0; k < m_keyframes.size(); ++k) {
+            delete m_keyframes[k];
+        }
+        m_keyframes.clear();
+        m_active = -1;
+    }
+
+    // Track live point pyramid (e.g. from DepthToVbo). Returns false, leaving
+    // pose unchanged, if tracking failed.
+    template<typename Management>
+    inline bool Track(const roo::Pyramid<float4,Levels,roo::TargetDevice,Management>& live_v)
+    {
+        if(m_active < 0) {
+            MakeKeyframe(live_v);
+            return true;
+        }
+
+        const DenseKeyframe<Levels>& kf = *m_keyframes[m_active];
+        const Sophus::SE3d T_lk_guess = m_T_wl.inverse() * kf.T_wk;
+
+        const roo::IcpState icp = roo::IcpPointPlaneCoarseToFine<Levels,roo::RobustTukey>(
+            live_v, kf.v, kf.n, m_K, T_lk_guess.matrix3x4(), its, icp_c, prior, m_workspace, m_debug
+        );
+        m_stats = icp.stats;
+
+        // Raw RMSE is dominated by occlusion boundaries, so judge tracking
+        // by the fraction of residuals within icp_c instead.
+        if( icp.stats.InlierRatio() < min_inlier_ratio ) {
+            return false;
+        }
+
+        const Eigen::Matrix<double,3,4> mT_lk = icp.T_lr;
+        const Sophus::SE3d T_lk( Eigen::Quaterniond(mT_lk.block<3,3>(0,0)).normalized(), mT_lk.col(3) );
+        m_T_wl = kf.T_wk * T_lk.inverse();
+
+        if( Overlap() < min_overlap || !WithinMotion(T_lk) ) {
+            const int k = NearestKeyframe(m_T_wl);
+            if(k >= 0 && k != m_active) {
+                m_active = k;
+            }else{
+                MakeKeyframe(live_v);
+            }
+        }
+        return true;
+    }
+
+    // Fraction of active keyframe's points observed by last tracked frame
+    inline float Overlap() const
+    {
+        const DenseKeyframe<Levels>& kf = *m_keyframes[m_active];
+        return kf.num_points > 0 ? (float)m_stats.lss.obs / kf.num_points : 0.0f;
+    }
+
+    inline const Sophus::SE3d& T_wl() const
+    {
+        return m_T_wl;
+    }
+
+    inline void SetT_wl(const Sophus::SE3d& T_wl)
+    {
+        m_T_wl = T_wl;
+    }
+
+    inline const roo::IcpStatistics& Statistics() const
+    {
+        return m_stats;
+    }
+
+    inline size_t NumKeyframes() const
+    {
+        return m_keyframes.size();
+    }
+
+    inline int ActiveKeyframe() const
+    {
+        return m_active;
+    }
+
+    inline const DenseKeyframe<Levels>& Keyframe(int k) const
+    {
+        return *m_keyframes[k];
+    }
+
+    inline roo::Image<float4> Debug()
+    {
+        return m_debug;
+    }
+
+    // Tracking parameters, as IcpPointPlaneCoarseToFine
+    int its[Levels];
+    float icp_c;
+    float prior;
+    float min_inlier_ratio;
+
+    // Keyframe selection thresholds
+    float min_overlap;
+    float max_translation;
+    float max_rotation;
+
+protected:
+    inline bool WithinMotion(const Sophus::SE3d& T_ab) const
+    {
+        return T_ab.translation().norm() < max_translation &&
+               T_ab.so3().log().norm() < max_rotation;
+    }
+
+    // Nearest cached keyframe to T_wl within motion thresholds, or -1
+    inline int NearestKeyframe(const Sophus::SE3d& T_wl) const
+    {
+        int best = -1;
+        double best_dist = 1E10;
+        for(size_t k=0; k < m_keyframes.size(); ++k) {
+            const Sophus::SE3d T_lk = T_wl.inverse() * m_keyframes[k]->T_wk;
+            const double dist = T_lk.translation().norm();
+            if( (int)k != m_active && WithinMotion(T_lk) && dist < best_dist ) {
+                best = k;
+                best_dist = dist;
+            }
+        }
+        return best;
+    }
+
+    template<typename Management>
+    inline void MakeKeyframe(const roo::Pyramid<float4,Levels,roo::TargetDevice,Management>& live_v)
+    {
+        int k = m_keyframes.size();
+        if(k < (int)m_max_keyframes) {
+            m_keyframes.push_back( new DenseKeyframe<Levels>(m_w, m_h) );
+        }else{
+            // Recycle keyframe furthest from current pose
+            double worst_dist = -1;
+            for(size_t i=0; i < m_keyframes.size(); ++i) {
+                const double dist = (m_keyframes[i]->T_wk.translation() - m_T_wl.translation()).norm();
+                if(dist > worst_dist) {
+                    k = i;
+                    worst_dist = dist;
+                }
+            }
+        }
+
+        DenseKeyframe<Levels>& kf = *m_keyframes[k];
+        kf.v.CopyFrom(live_v);
+        for(unsigned l=0; l < Levels; ++l) {
+            roo::NormalsFromVbo(kf.n.imgs[l], kf.v.imgs[l]);
+        }
+        kf.T_wk = m_T_wl;
+
+        // Count reference points by aligning keyframe to itself
+        const Eigen::Matrix<double,3,4> T_id = Sophus::SE3d().matrix3x4();
+        const Eigen::Matrix<double,3,4> KT_id = m_K.Matrix() * T_id;
+        const roo::IcpStatistics self = roo::PoseRefinementProjectiveIcpPointPlaneRobust<roo::RobustSq>(
+            kf.v.imgs[0], kf.v.imgs[0], kf.n.imgs[0], KT_id, T_id, icp_c, m_workspace, m_debug
+        );
+        kf.num_points = self.lss.obs;
+
+        m_active = k;
+        m_stats = self;
+    }
+
+    unsigned m_w;
+    unsigned m_h;
+    roo::ImageIntrinsics m_K;
+    unsigned m_max_keyframes;
+
+    std::vector<DenseKeyframe<Levels>*> m_keyframes;
+    int m_active;
+
+    Sophus::SE3d m_T_wl;
+    roo::IcpStatistics m_stats;
+
+    roo::Image<unsigned char, roo::TargetDevice, roo::Manage> m_workspace;
+    roo::Image<float4, roo::TargetDevice, roo::Manage> m_debug;
+};
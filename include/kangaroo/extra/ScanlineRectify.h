@@ -7,6 +7,7 @@
 
 #include "CameraModelPyramid.h"
 #include "BaselineFromCamModel.h"
+#include "ScanlineRectifyCameraModel.h"
 
 #include <kangaroo/kangaroo.h>
 
@@ -33,25 +34,7 @@ inline Sophus::SE3d CreateScanlineRectifiedLookupAndT_rl(
     const Eigen::Vector3d l_r = T_rl.translation();
     const Eigen::Vector3d r_l = - (R_lr * l_r);
 
-    // Current up vector for each camera (in left FoR)
-    const Eigen::Vector3d lup_l = Eigen::Vector3d(0,1,0);
-    const Eigen::Vector3d rup_l = R_lr * Eigen::Vector3d(0,1,0);
-
-    // Hypothetical fwd vector for each camera, perpendicular to baseline (in left FoR)
-    const Eigen::Vector3d lfwd = lup_l.cross(r_l);
-    const Eigen::Vector3d rfwd = rup_l.cross(r_l);
-
-    // New fwd is average of left / right hypothetical baselines (also perpendicular to baseline)
-    const Eigen::Vector3d new_fwd = (lfwd + rfwd).normalized();
-
-    // Define new basis (in left FoR);
-    const Eigen::Vector3d x = r_l.normalized();
-    const Eigen::Vector3d z = -new_fwd;
-    const Eigen::Vector3d y  = z.cross(x).normalized();
-
-    // New orientation for both left and right cameras (expressed relative to original left)
-    Eigen::Matrix3d mR_nl;
-    mR_nl << x, y, z;
+    const Eigen::Matrix3d mR_nl = ScanlineRectifiedR_nl(T_rl);
 
     // By definition, the right camera now lies exactly on the x-axis with the same orientation
     // as the left camera.
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Eigen/Eigen>
+#include <sophus/se3.hpp>
+
+#include <kangaroo/Mat.h>
+#include <kangaroo/Image.h>
+#include <kangaroo/CameraModel.h>
+#include <kangaroo/cu_lookup_warp.h>
+
+// Orientation shared by scan-line rectified left and right cameras,
+// expressed relative to original left.
+inline Eigen::Matrix3d ScanlineRectifiedR_nl(const Sophus::SE3d& T_rl)
+{
+    const Sophus::SO3d R_lr = T_rl.so3().inverse();
+    const Eigen::Vector3d r_l = - (R_lr * T_rl.translation());
+
+    // Current up vector for each camera (in left FoR)
+    const Eigen::Vector3d lup_l = Eigen::Vector3d(0,1,0);
+    const Eigen::Vector3d rup_l = R_lr * Eigen::Vector3d(0,1,0);
+
+    // Hypothetical fwd vector for each camera, perpendicular to baseline (in left FoR)
+    const Eigen::Vector3d lfwd = lup_l.cross(r_l);
+    const Eigen::Vector3d rfwd = rup_l.cross(r_l);
+
+    // New fwd is average of left / right hypothetical baselines (also perpendicular to baseline)
+    const Eigen::Vector3d new_fwd = (lfwd + rfwd).normalized();
+
+    // Define new basis (in left FoR);
+    const Eigen::Vector3d x = r_l.normalized();
+    const Eigen::Vector3d z = -new_fwd;
+    const Eigen::Vector3d y  = z.cross(x).normalized();
+
+    // New orientation for both left and right cameras (expressed relative to original left)
+    Eigen::Matrix3d mR_nl;
+    mR_nl << x, y, z;
+
+    return mR_nl;
+}
+
+// Scan-line rectifying lookup tables for native camera models, supporting
+// any distortion roo::CameraModel does. Each rectified image keeps its camera's pinhole intrinsics.
+inline Sophus::SE3d CreateScanlineRectifiedLookupAndT_rl(
+    roo::Image<float2> dlookup_left, roo::Image<float2> dlookup_right,
+    const Sophus::SE3d T_rl, const roo::CameraModel& lcam, const roo::CameraModel& rcam
+) {
+    const Sophus::SO3d R_lr = T_rl.so3().inverse();
+    const Eigen::Vector3d r_l = - (R_lr * T_rl.translation());
+    const Eigen::Matrix3d mR_nl = ScanlineRectifiedR_nl(T_rl);
+
+    // Rotations taking rays of new cameras to original cameras
+    const Eigen::Matrix3d Rl_nl = mR_nl.transpose();
+    const Eigen::Matrix3d Rr_nr = (mR_nl * R_lr.matrix()).transpose();
+
+    roo::Mat<float,3,3> R_ol_nl;
+    roo::Mat<float,3,3> R_or_nr;
+
+    for(int r=0; r<3; ++r) {
+        for(int c=0; c<3; ++c) {
+            R_ol_nl(r,c) = Rl_nl(r,c);
+            R_or_nr(r,c) = Rr_nr(r,c);
+        }
+    }
+
+    roo::CreateLookupTable(dlookup_left, lcam, lcam.Intrinsics(), R_ol_nl);
+    roo::CreateLookupTable(dlookup_right, rcam, rcam.Intrinsics(), R_or_nr);
+
+    return Sophus::SE3d(Eigen::Matrix3d::Identity(), Eigen::Vector3d(-r_l.norm(),0,0) );
+}
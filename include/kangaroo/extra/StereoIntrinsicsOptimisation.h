@@ -39,6 +39,11 @@ static inline Eigen::Matrix<double,4,4> se3_gen(unsigned i) {
     return ret;
 }
 
+// Gauss-Newton step for intrinsics, T_rl and keyframe poses. The normal
+// equations have arrow structure: shared parameters a = (K, T_rl), coupled
+// to every keyframe pose b_kf but with poses independent of each other.
+// Each keyframe's (a, b_kf) system is built independently, then its pose
+// block eliminated by Schur complement, so cost is linear in keyframes.
 static void OptimiseIntrinsicsPoses(
     Eigen::Matrix<double,3,Eigen::Dynamic> pattern,
     std::vector<StereoKeyframe>& keyframes,
@@ -51,17 +56,26 @@ static void OptimiseIntrinsicsPoses(
     typedef CamParamMatlab<calibu::CameraModel<calibu::Poly> > CamParam;
     const int PARAMS_K = CamParam::PARAMS;
     const int PARAMS_T = 6;
+    const int PARAMS_A = PARAMS_K + PARAMS_T;
     const int PARAMS_TOTAL = PARAMS_K + (1+N)* PARAMS_T;
 
     unsigned int num_obs = 0;
     double sumsqerr = 0;
-    Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic> JTJ(PARAMS_TOTAL,PARAMS_TOTAL);
-    Eigen::Matrix<double,Eigen::Dynamic,1> JTy(PARAMS_TOTAL);
-    JTJ.setZero();
-    JTy.setZero();
+
+    // Per keyframe Schur complement contributions, and blocks for back substitution
+    std::vector<Eigen::MatrixXd> S_kf(N), Vinv_kf(N), W_kf(N);
+    std::vector<Eigen::VectorXd> Sy_kf(N), Vy_kf(N);
+    std::vector<int> rank_V(N);
 
     // Make JTJ and JTy from observations over each Keyframe
-    for( size_t kf=0; kf < N; ++kf ) {
+#pragma omp parallel for reduction(+:sumsqerr,num_obs)
+    for( int kf=0; kf < N; ++kf ) {
+        // Keyframe system over (K, T_rl, T_lw)
+        Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic> JTJ(PARAMS_A+PARAMS_T,PARAMS_A+PARAMS_T);
+        Eigen::Matrix<double,Eigen::Dynamic,1> JTy(PARAMS_A+PARAMS_T);
+        JTJ.setZero();
+        JTy.setZero();
+
         // For each observation
         for( size_t on=0; on < pattern.cols(); ++on ) {
             // Construct block contributions for JTJ and JTy
@@ -91,7 +105,7 @@ static void OptimiseIntrinsicsPoses(
                 }
 
                 AddSparseOuterProduct<double,2,PARAMS_K,PARAMS_T>(
-                    JTJ,JTy,  Jk,0,  J_T_lw,PARAMS_K+(1+kf)*PARAMS_T, errl
+                    JTJ,JTy,  Jk,0,  J_T_lw,PARAMS_A, errl
                 );
             }
 
@@ -119,22 +133,51 @@ static void OptimiseIntrinsicsPoses(
                 }
 
                 AddSparseOuterProduct<double,2,PARAMS_K,PARAMS_T,PARAMS_T>(
-                    JTJ,JTy,  Jk,0,  J_T_rl,PARAMS_K,  J_T_lw,PARAMS_K+(1+kf)*PARAMS_T, errr
+                    JTJ,JTy,  Jk,0,  J_T_rl,PARAMS_K,  J_T_lw,PARAMS_A, errr
                 );
             }
         }
+
+        // Eliminate keyframe pose: S = U - W V^-1 W^T, Sy = ya - W V^-1 yb
+        const Eigen::Matrix<double,PARAMS_T,PARAMS_T> V = JTJ.bottomRightCorner<PARAMS_T,PARAMS_T>();
+        Eigen::FullPivLU<Eigen::Matrix<double,PARAMS_T,PARAMS_T> > lu_V(V);
+        rank_V[kf] = lu_V.rank();
+        W_kf[kf] = JTJ.topRightCorner(PARAMS_A,PARAMS_T);
+        Vinv_kf[kf] = lu_V.inverse();
+        Vy_kf[kf] = JTy.tail<PARAMS_T>();
+
+        const Eigen::MatrixXd WVinv = W_kf[kf] * Vinv_kf[kf];
+        S_kf[kf] = JTJ.topLeftCorner(PARAMS_A,PARAMS_A) - WVinv * W_kf[kf].transpose();
+        Sy_kf[kf] = JTy.head(PARAMS_A) - WVinv * Vy_kf[kf];
     }
 
     std::cout << "=============== RMSE: " << sqrt(sumsqerr/num_obs) << " ====================" << std::endl;
 
-    Eigen::FullPivLU<Eigen::MatrixXd> lu_JTJ(JTJ);
-    Eigen::Matrix<double,Eigen::Dynamic,1> x = -1.0 * lu_JTJ.solve(JTy);
+    Eigen::MatrixXd S = Eigen::MatrixXd::Zero(PARAMS_A,PARAMS_A);
+    Eigen::VectorXd Sy = Eigen::VectorXd::Zero(PARAMS_A);
+    int missing = 0;
+    for( int kf=0; kf < N; ++kf ) {
+        S += S_kf[kf];
+        Sy += Sy_kf[kf];
+        missing += PARAMS_T - rank_V[kf];
+    }
+
+    Eigen::FullPivLU<Eigen::MatrixXd> lu_S(S);
+    missing += PARAMS_A - lu_S.rank();
+
+    // Shared parameters, then back substitute for each pose
+    Eigen::Matrix<double,Eigen::Dynamic,1> x(PARAMS_TOTAL);
+    x.head(PARAMS_A) = -1.0 * lu_S.solve(Sy);
+    for( int kf=0; kf < N; ++kf ) {
+        x.segment<PARAMS_T>(PARAMS_A + kf*PARAMS_T) =
+            -1.0 * Vinv_kf[kf] * (Vy_kf[kf] + W_kf[kf].transpose() * x.head(PARAMS_A));
+    }
 
     if( x.norm() > 1 ) {
         x = x / x.norm();
     }
 
-    if( lu_JTJ.rank() == PARAMS_TOTAL )
+    if( missing == 0 )
     {
         CamParam::UpdateCam(cam, x.head<PARAMS_K>());
 
@@ -151,7 +194,7 @@ static void OptimiseIntrinsicsPoses(
         std::cout << cam << std::endl;
         std::cout << T_rl.matrix() << std::endl;
     }else{
-        std::cerr << "Rank deficient! Missing: " << (PARAMS_TOTAL - lu_JTJ.rank()) << std::endl;
-        std::cerr << lu_JTJ.kernel() << std::endl;
+        std::cerr << "Rank deficient! Missing: " << missing << std::endl;
+        std::cerr << lu_S.kernel() << std::endl;
     }
 }
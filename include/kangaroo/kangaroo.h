@@ -32,13 +32,21 @@
 #include "cu_semi_global_matching.h"
 #include "cu_blur.h"
 #include "cu_manhattan.h"
+#include "cu_ransac.h"
+#include "cu_plane_segmentation.h"
 #include "cu_convolution.h"
+#include "cu_fft_convolution.h"
 #include "cu_integral_image.h"
 #include "cu_segment_test.h"
+#include "cu_descriptors.h"
+#include "cu_klt.h"
+#include "cu_optical_flow.h"
 #include "cu_painting.h"
 #include "cu_raycast.h"
 #include "cu_sdffusion.h"
+#include "cu_sdf_points.h"
 #include "cu_remap.h"
 #include "cu_deconvolution.h"
 #include "cu_rof_denoising.h"
 #include "cu_tgv.h"
+#include "cu_primal_dual.h"
@@ -135,6 +135,13 @@ float ConvertPixel(uchar3 p)
     return (p.x+p.y+p.z) / (3.0f*255.0f);
 }
 
+template<>
+__host__ __device__ inline
+float ConvertPixel(uchar4 p)
+{
+    return (p.x+p.y+p.z) / (3.0f*255.0f);
+}
+
 template<>
 __host__ __device__ inline
 float4 ConvertPixel(uchar4 p)
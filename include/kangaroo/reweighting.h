@@ -1,3 +1,5 @@
+#pragma once
+
 #include <cuda_runtime.h>
 
 namespace roo {
@@ -33,4 +35,29 @@ float LSReweightCauchy(float r, float c) {
     return 1.0f / (1.0f + roc*roc);
 }
 
+//////////////////////////////////////////////////////
+// Robust kernels as types, for compile time selection in templated
+// reductions. Weight(r,c) is the IRLS weight for residual r with scale c.
+//////////////////////////////////////////////////////
+
+struct RobustSq {
+    __host__ __device__ static inline
+    float Weight(float r, float c) { return LSReweightSq(r,c); }
+};
+
+struct RobustHuber {
+    __host__ __device__ static inline
+    float Weight(float r, float c) { return LSReweightHuber(r,c); }
+};
+
+struct RobustTukey {
+    __host__ __device__ static inline
+    float Weight(float r, float c) { return LSReweightTukey(r,c); }
+};
+
+struct RobustCauchy {
+    __host__ __device__ static inline
+    float Weight(float r, float c) { return LSReweightCauchy(r,c); }
+};
+
 }
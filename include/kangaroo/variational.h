@@ -3,3 +3,4 @@
 #include "Divergence.h"
 #include "cu_rof_denoising.h"
 #include "cu_tgv.h"
+#include "cu_primal_dual.h"
@@ -131,10 +131,157 @@ void GaussianBlur(Image<Tout> out, Image<Tin> in, Image<Tout> temp, float sigma)
     }
 }
 
+//////////////////////////////////////////////////////
+// Recursive Gaussian Blur
+// Young and van Vliet 3rd order IIR filter. Each thread runs causal and
+// anti-causal passes down one column, so reads across a warp coalesce.
+// Rows are filtered the same way after a shared memory tile transpose.
+//////////////////////////////////////////////////////
+
+const int RecursiveTile = 32;
+
+template<typename T>
+__host__ __device__ inline
+T RecursivePixel(float v)
+{
+    return v;
+}
+
+template<>
+__host__ __device__ inline
+unsigned char RecursivePixel(float v)
+{
+    return max(0.0f, min(v + 0.5f, 255.0f));
+}
+
+// Coefficients (B, b1/b0, b2/b0, b3/b0) for scale parameter q
+inline float4 YoungVanVlietCoeffs(double q)
+{
+    const double q2 = q*q;
+    const double q3 = q2*q;
+    const double b0 = 1.57825 + 2.44413*q + 1.4281*q2 + 0.422205*q3;
+    const double b1 = 2.44413*q + 2.85619*q2 + 1.26661*q3;
+    const double b2 = -(1.4281*q2 + 1.26661*q3);
+    const double b3 = 0.422205*q3;
+    return make_float4( 1.0 - (b1+b2+b3)/b0, b1/b0, b2/b0, b3/b0 );
+}
+
+// Variance of causal followed by anti-causal filter, from the cumulants of
+// B / (1 - a1 z^-1 - a2 z^-2 - a3 z^-3)
+inline double RecursiveGaussianVariance(const float4 c)
+{
+    const double d0 = 1.0 - c.y - c.z - c.w;
+    const double d1 = -(c.y + 2*c.z + 3*c.w);
+    const double d2 = -(c.y + 4*c.z + 9*c.w);
+    return 2 * (d1*d1 - d2*d0) / (d0*d0);
+}
+
+// Young and van Vliet's fit for q(sigma) overestimates sigma by up to 10%,
+// so choose q such that the filter variance is exactly sigma^2.
+inline float4 RecursiveGaussianCoeffs(float sigma)
+{
+    const double var = max(sigma, 0.5f) * max(sigma, 0.5f);
+    double qmin = 0;
+    double qmax = sigma + 1;
+    for(int i=0; i < 40; ++i) {
+        const double q = (qmin + qmax) / 2;
+        if( RecursiveGaussianVariance(YoungVanVlietCoeffs(q)) < var ) {
+            qmin = q;
+        }else{
+            qmax = q;
+        }
+    }
+    return YoungVanVlietCoeffs((qmin + qmax) / 2);
+}
+
+template<typename TI>
+__global__ void KernRecursiveGaussianY(Image<float> out, Image<TI> in, float4 c)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+
+    if(x < out.w) {
+        // Causal pass, initialised to steady state of replicated border
+        float w1 = in(x,0);
+        float w2 = w1;
+        float w3 = w1;
+        for(int y=0; y < out.h; ++y) {
+            const float w0 = c.x*in(x,y) + c.y*w1 + c.z*w2 + c.w*w3;
+            out(x,y) = w0;
+            w3 = w2; w2 = w1; w1 = w0;
+        }
+
+        // Anti-causal pass, in place
+        float y1 = w1;
+        float y2 = w1;
+        float y3 = w1;
+        for(int y=out.h-1; y >= 0; --y) {
+            const float y0 = c.x*out(x,y) + c.y*y1 + c.z*y2 + c.w*y3;
+            out(x,y) = y0;
+            y3 = y2; y2 = y1; y1 = y0;
+        }
+    }
+}
+
+template<typename TO>
+__global__ void KernRecursiveTranspose(Image<TO> out, Image<float> in)
+{
+    __shared__ float tile[RecursiveTile][RecursiveTile+1];
+
+    const int x = blockIdx.x*RecursiveTile + threadIdx.x;
+    const int y = blockIdx.y*RecursiveTile;
+    for(int j=threadIdx.y; j < RecursiveTile; j += blockDim.y) {
+        if(x < in.w && y+j < in.h) {
+            tile[j][threadIdx.x] = in(x,y+j);
+        }
+    }
+    __syncthreads();
+
+    const int ox = blockIdx.y*RecursiveTile + threadIdx.x;
+    const int oy = blockIdx.x*RecursiveTile;
+    for(int j=threadIdx.y; j < RecursiveTile; j += blockDim.y) {
+        if(ox < out.w && oy+j < out.h) {
+            out(ox,oy+j) = RecursivePixel<TO>(tile[threadIdx.x][j]);
+        }
+    }
+}
+
+template<typename Tout, typename Tin>
+void GaussianBlurRecursive(Image<Tout> out, Image<Tin> in, Image<unsigned char> dWorkspace, float sigma)
+{
+    Image<unsigned char> scratch = dWorkspace;
+    Image<float> imgcols = scratch.SplitAlignedImage<float>(in.w, in.h);
+    Image<float> imgrows = scratch.SplitAlignedImage<float>(in.h, in.w);
+
+    const float4 c = RecursiveGaussianCoeffs(sigma);
+    dim3 blockDim, gridDim;
+
+    // Filter columns of in
+    blockDim = dim3(64,1);
+    gridDim = dim3(ceil(in.w / (double)blockDim.x), 1);
+    KernRecursiveGaussianY<Tin><<<gridDim,blockDim>>>(imgcols, in, c);
+
+    InitDimFromOutputImageOver(blockDim,gridDim, imgcols, RecursiveTile, RecursiveTile);
+    blockDim.y = 8;
+    KernRecursiveTranspose<float><<<gridDim,blockDim>>>(imgrows, imgcols);
+
+    // Filter rows of in, stored as columns of imgrows
+    blockDim = dim3(64,1);
+    gridDim = dim3(ceil(in.h / (double)blockDim.x), 1);
+    KernRecursiveGaussianY<float><<<gridDim,blockDim>>>(imgrows, imgrows, c);
+
+    InitDimFromOutputImageOver(blockDim,gridDim, imgrows, RecursiveTile, RecursiveTile);
+    blockDim.y = 8;
+    KernRecursiveTranspose<Tout><<<gridDim,blockDim>>>(out, imgrows);
+    GpuCheckErrors();
+}
+
 template KANGAROO_EXPORT void GaussianBlur<unsigned char,unsigned char, 5,  1024>(Image<unsigned char>, Image<unsigned char>, Image<unsigned char>, float);
 template KANGAROO_EXPORT void GaussianBlur<unsigned char,unsigned char, 10, 1024>(Image<unsigned char>, Image<unsigned char>, Image<unsigned char>, float);
 template KANGAROO_EXPORT void GaussianBlur<unsigned char,unsigned char, 15, 1024>(Image<unsigned char>, Image<unsigned char>, Image<unsigned char>, float);
 template KANGAROO_EXPORT void GaussianBlur<unsigned char,unsigned char, 20, 1024>(Image<unsigned char>, Image<unsigned char>, Image<unsigned char>, float);
 
+template KANGAROO_EXPORT void GaussianBlurRecursive<float,float>(Image<float>, Image<float>, Image<unsigned char>, float);
+template KANGAROO_EXPORT void GaussianBlurRecursive<float,unsigned char>(Image<float>, Image<unsigned char>, Image<unsigned char>, float);
+template KANGAROO_EXPORT void GaussianBlurRecursive<unsigned char,unsigned char>(Image<unsigned char>, Image<unsigned char>, Image<unsigned char>, float);
 
 }
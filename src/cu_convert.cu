@@ -29,6 +29,90 @@ void ConvertImage(Image<To> dOut, const Image<Ti> dIn)
     KernConvertImage<<<gridDim,blockDim>>>(dOut,dIn);
 }
 
+//////////////////////////////////////////////////////
+// Colour space conversion
+//////////////////////////////////////////////////////
+
+template<typename To, typename Ti>
+__global__
+void KernConvertRgbToGray(Image<To> dOut, const Image<Ti> dIn)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    if(dOut.InBounds(x,y)) {
+        dOut(x,y) = RgbToGray<To,Ti>(dIn(x,y));
+    }
+}
+
+template<typename To, typename Ti>
+void ConvertRgbToGray(Image<To> dOut, const Image<Ti> dIn)
+{
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dOut);
+    KernConvertRgbToGray<To,Ti><<<gridDim,blockDim>>>(dOut,dIn);
+    GpuCheckErrors();
+}
+
+template<typename To>
+__global__
+void KernConvertYUYV(Image<To> dOut, const Image<uchar4> dIn)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    if(dOut.InBounds(x,y)) {
+        dOut(x,y) = YUYVPixel<To>(dIn, x, y);
+    }
+}
+
+template<typename To>
+void ConvertYUYV(Image<To> dOut, const Image<uchar4> dIn)
+{
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dOut);
+    KernConvertYUYV<To><<<gridDim,blockDim>>>(dOut,dIn);
+    GpuCheckErrors();
+}
+
+template<typename To>
+__global__
+void KernConvertNV12(Image<To> dOut, const Image<unsigned char> dIn)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    if(dOut.InBounds(x,y)) {
+        dOut(x,y) = NV12Pixel<To>(dIn, dOut.h, x, y);
+    }
+}
+
+template<typename To>
+void ConvertNV12(Image<To> dOut, const Image<unsigned char> dIn)
+{
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dOut);
+    KernConvertNV12<To><<<gridDim,blockDim>>>(dOut,dIn);
+    GpuCheckErrors();
+}
+
+template<typename To>
+__global__
+void KernDemosaicBayer(Image<To> dOut, const Image<unsigned char> dIn, BayerPattern pattern)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    if(dOut.InBounds(x,y)) {
+        dOut(x,y) = BayerPixel<To>(dIn, x, y, pattern);
+    }
+}
+
+template<typename To>
+void DemosaicBayer(Image<To> dOut, const Image<unsigned char> dIn, BayerPattern pattern)
+{
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dOut);
+    KernDemosaicBayer<To><<<gridDim,blockDim>>>(dOut,dIn,pattern);
+    GpuCheckErrors();
+}
+
 // Explicit instantiation
 template KANGAROO_EXPORT void ConvertImage<float,unsigned char>(Image<float>, const Image<unsigned char>);
 template KANGAROO_EXPORT void ConvertImage<float,unsigned short>(Image<float>, const Image<unsigned short>);
@@ -42,6 +126,32 @@ template KANGAROO_EXPORT void ConvertImage<unsigned char, uchar3>(Image<unsigned
 template KANGAROO_EXPORT void ConvertImage<unsigned char, uchar4>(Image<unsigned char>, const Image<uchar4>);
 template KANGAROO_EXPORT void ConvertImage<float4, float>(Image<float4>, const Image<float>);
 template KANGAROO_EXPORT void ConvertImage<float4, uchar3>(Image<float4>, const Image<uchar3>);
+template KANGAROO_EXPORT void ConvertImage<float4, uchar4>(Image<float4>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertImage<float, uchar3>(Image<float>, const Image<uchar3>);
+template KANGAROO_EXPORT void ConvertImage<float, uchar4>(Image<float>, const Image<uchar4>);
+
+template KANGAROO_EXPORT void ConvertRgbToGray<unsigned char, uchar3>(Image<unsigned char>, const Image<uchar3>);
+template KANGAROO_EXPORT void ConvertRgbToGray<unsigned char, uchar4>(Image<unsigned char>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertRgbToGray<float, uchar3>(Image<float>, const Image<uchar3>);
+template KANGAROO_EXPORT void ConvertRgbToGray<float, uchar4>(Image<float>, const Image<uchar4>);
+
+template KANGAROO_EXPORT void ConvertYUYV<unsigned char>(Image<unsigned char>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertYUYV<float>(Image<float>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertYUYV<uchar3>(Image<uchar3>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertYUYV<uchar4>(Image<uchar4>, const Image<uchar4>);
+template KANGAROO_EXPORT void ConvertYUYV<float4>(Image<float4>, const Image<uchar4>);
+
+template KANGAROO_EXPORT void ConvertNV12<unsigned char>(Image<unsigned char>, const Image<unsigned char>);
+template KANGAROO_EXPORT void ConvertNV12<float>(Image<float>, const Image<unsigned char>);
+template KANGAROO_EXPORT void ConvertNV12<uchar3>(Image<uchar3>, const Image<unsigned char>);
+template KANGAROO_EXPORT void ConvertNV12<uchar4>(Image<uchar4>, const Image<unsigned char>);
+template KANGAROO_EXPORT void ConvertNV12<float4>(Image<float4>, const Image<unsigned char>);
+
+template KANGAROO_EXPORT void DemosaicBayer<unsigned char>(Image<unsigned char>, const Image<unsigned char>, BayerPattern);
+template KANGAROO_EXPORT void DemosaicBayer<float>(Image<float>, const Image<unsigned char>, BayerPattern);
+template KANGAROO_EXPORT void DemosaicBayer<uchar3>(Image<uchar3>, const Image<unsigned char>, BayerPattern);
+template KANGAROO_EXPORT void DemosaicBayer<uchar4>(Image<uchar4>, const Image<unsigned char>, BayerPattern);
+template KANGAROO_EXPORT void DemosaicBayer<float4>(Image<float4>, const Image<unsigned char>, BayerPattern);
 
 
 } // namespace roo
@@ -44,6 +44,111 @@ void Convolution(
     KernConvolution<OT,IT,KT,ACC><<<gridDim,blockDim>>>(out,in,kern,kx,ky);
 }
 
+//////////////////////////////////////////////////////
+// Separable convolution
+// Row pass caches a (BW+2*RAD) x BH strip per block, column pass a
+// BW x (BH+2*RAD) strip, so each input pixel is read once per pass.
+// Neumann reflection mirrors at most RAD pixels, so it needs RAD < w and
+// RAD < h. Loads past the reflected border only fill cache entries for
+// threads outside the image, and are clamped to stay in bounds.
+//////////////////////////////////////////////////////
+
+const int SepBW = 32;
+const int SepBH = 8;
+
+template<typename OT, typename IT, unsigned RAD>
+__global__ void KernConvolutionSeparableRows(
+    Image<OT> out, Image<IT> in, const Mat<float,2*RAD+1> krow
+) {
+    __shared__ float cache[SepBH][SepBW + 2*RAD];
+
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    const int x0 = blockIdx.x * blockDim.x - RAD;
+    const int yc = min(y, (int)in.h-1);
+
+    for(int i=threadIdx.x; i < SepBW + 2*RAD; i += blockDim.x) {
+        cache[threadIdx.y][i] = in.GetConditionNeumann(min(x0 + i, (int)(in.w-1+RAD)), yc);
+    }
+    __syncthreads();
+
+    if(x < out.w && y < out.h) {
+        float sum = 0;
+#pragma unroll
+        for(int k=0; k <= 2*RAD; ++k) {
+            sum += krow[k] * cache[threadIdx.y][threadIdx.x + k];
+        }
+        out(x,y) = sum;
+    }
+}
+
+template<typename OT, typename IT, unsigned RAD>
+__global__ void KernConvolutionSeparableCols(
+    Image<OT> out, Image<IT> in, const Mat<float,2*RAD+1> kcol
+) {
+    __shared__ float cache[SepBH + 2*RAD][SepBW];
+
+    const int x = blockIdx.x * blockDim.x + threadIdx.x;
+    const int y = blockIdx.y * blockDim.y + threadIdx.y;
+    const int y0 = blockIdx.y * blockDim.y - RAD;
+    const int xc = min(x, (int)in.w-1);
+
+    for(int i=threadIdx.y; i < SepBH + 2*RAD; i += blockDim.y) {
+        cache[i][threadIdx.x] = in.GetConditionNeumann(xc, min(y0 + i, (int)(in.h-1+RAD)));
+    }
+    __syncthreads();
+
+    if(x < out.w && y < out.h) {
+        float sum = 0;
+#pragma unroll
+        for(int k=0; k <= 2*RAD; ++k) {
+            sum += kcol[k] * cache[threadIdx.y + k][threadIdx.x];
+        }
+        out(x,y) = sum;
+    }
+}
+
+template<typename OT, typename IT, unsigned RAD>
+void ConvolutionSeparable(
+    Image<OT> out, Image<IT> in, Image<float> temp,
+    const Mat<float,2*RAD+1> krow, const Mat<float,2*RAD+1> kcol
+) {
+    assert(RAD < in.w && RAD < in.h);
+    dim3 gridDim, blockDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, out, SepBW, SepBH);
+    KernConvolutionSeparableRows<float,IT,RAD><<<gridDim,blockDim>>>(temp,in,krow);
+    KernConvolutionSeparableCols<OT,float,RAD><<<gridDim,blockDim>>>(out,temp,kcol);
+}
+
+bool SeparateKernel(const Image<float,TargetHost> kern, float* krow, float* kcol, float tol)
+{
+    // Pivot on largest magnitude element
+    unsigned pc = 0, pr = 0;
+    for(unsigned r=0; r < kern.h; ++r) {
+        for(unsigned c=0; c < kern.w; ++c) {
+            if( fabs(kern(c,r)) > fabs(kern(pc,pr)) ) {
+                pc = c;
+                pr = r;
+            }
+        }
+    }
+
+    const float pivot = kern(pc,pr);
+    if(pivot == 0) return false;
+
+    for(unsigned c=0; c < kern.w; ++c) krow[c] = kern(c,pr);
+    for(unsigned r=0; r < kern.h; ++r) kcol[r] = kern(pc,r) / pivot;
+
+    for(unsigned r=0; r < kern.h; ++r) {
+        for(unsigned c=0; c < kern.w; ++c) {
+            if( fabs(kcol[r]*krow[c] - kern(c,r)) > tol * fabs(pivot) ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 //////////////////////////////////////////////////////
 // Instantiate templates
 //////////////////////////////////////////////////////
@@ -51,5 +156,18 @@ void Convolution(
 template KANGAROO_EXPORT void Convolution<float,float,float,float>(Image<float> out,  Image<float> in,  Image<float> kern, int kx, int ky);
 template KANGAROO_EXPORT void Convolution<float,unsigned char,unsigned char,float>(Image<float> out,  Image<unsigned char> in,  Image<unsigned char> kern, int kx, int ky);
 
-}
 
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,1>(Image<float>, Image<float>, Image<float>, const Mat<float,3>, const Mat<float,3>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,2>(Image<float>, Image<float>, Image<float>, const Mat<float,5>, const Mat<float,5>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,3>(Image<float>, Image<float>, Image<float>, const Mat<float,7>, const Mat<float,7>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,5>(Image<float>, Image<float>, Image<float>, const Mat<float,11>, const Mat<float,11>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,7>(Image<float>, Image<float>, Image<float>, const Mat<float,15>, const Mat<float,15>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,float,10>(Image<float>, Image<float>, Image<float>, const Mat<float,21>, const Mat<float,21>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,1>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,3>, const Mat<float,3>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,2>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,5>, const Mat<float,5>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,3>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,7>, const Mat<float,7>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,5>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,11>, const Mat<float,11>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,7>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,15>, const Mat<float,15>);
+template KANGAROO_EXPORT void ConvolutionSeparable<float,unsigned char,10>(Image<float>, Image<unsigned char>, Image<float>, const Mat<float,21>, const Mat<float,21>);
+
+}
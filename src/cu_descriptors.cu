@@ -0,0 +1,280 @@
+#include "cu_descriptors.h"
+
+#include "MatUtils.h"
+#include "hamming_distance.h"
+#include "launch_utils.h"
+
+#ifndef M_PI
+// Some trouble with Maths defines with MSVC
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Oriented BRIEF descriptors
+//////////////////////////////////////////////////////
+
+const int BriefPatchRadius = 15;
+const int BriefPairRadius = 13;
+
+// Fixed sampling pattern: isotropic Gaussian (sigma = 31/5) point pairs,
+// rejected outside BriefPairRadius so rotated samples stay within patch.
+// Uses its own LCG so descriptors agree across platforms.
+inline Mat<char4,256> BriefPattern()
+{
+    Mat<char4,256> pattern;
+    unsigned int seed = 0x2545F491;
+    const float sigma = 31.0f / 5.0f;
+
+    for(int b=0; b < 256; ) {
+        float g[4];
+        for(int k=0; k < 4; k += 2) {
+            seed = 1664525u*seed + 1013904223u;
+            const float u1 = ((seed >> 8) + 0.5f) / 16777216.0f;
+            seed = 1664525u*seed + 1013904223u;
+            const float u2 = ((seed >> 8) + 0.5f) / 16777216.0f;
+            const float r = sigma * sqrt(-2.0f * log(u1));
+            g[k]   = r * cos(2.0f * (float)M_PI * u2);
+            g[k+1] = r * sin(2.0f * (float)M_PI * u2);
+        }
+
+        const float R2 = BriefPairRadius*BriefPairRadius;
+        if( g[0]*g[0] + g[1]*g[1] <= R2 && g[2]*g[2] + g[3]*g[3] <= R2 ) {
+            pattern[b++] = make_char4( floor(g[0]+0.5f), floor(g[1]+0.5f), floor(g[2]+0.5f), floor(g[3]+0.5f) );
+        }
+    }
+
+    return pattern;
+}
+
+template<unsigned Levels>
+__global__ void KernBriefDescriptors(
+    Image<uint4> descriptors, const Image<Keypoint> keypoints, unsigned int num_keypoints,
+    const Pyramid<unsigned char,Levels> pyr, const Mat<char4,256> pattern, bool oriented
+) {
+    const unsigned int i = blockIdx.x*blockDim.x + threadIdx.x;
+
+    if(i < num_keypoints) {
+        const Keypoint kp = keypoints(i,0);
+        const Image<unsigned char> img = pyr.imgs[min(kp.level, (int)Levels-1)];
+        const float2 p = kp.LevelPos();
+        const int px = floor(p.x + 0.5f);
+        const int py = floor(p.y + 0.5f);
+
+        // Orientation from intensity centroid over circular patch
+        float c = 1;
+        float s = 0;
+        if(oriented) {
+            int m10 = 0;
+            int m01 = 0;
+            for(int dy=-BriefPatchRadius; dy <= BriefPatchRadius; ++dy) {
+                const int dxmax = sqrtf(BriefPatchRadius*BriefPatchRadius - dy*dy);
+                for(int dx=-dxmax; dx <= dxmax; ++dx) {
+                    const int v = img.GetWithClampedRange(px+dx, py+dy);
+                    m10 += dx * v;
+                    m01 += dy * v;
+                }
+            }
+            const float norm = sqrtf((float)m10*m10 + (float)m01*m01);
+            if(norm > 0) {
+                c = m10 / norm;
+                s = m01 / norm;
+            }
+        }
+
+        unsigned int words[8];
+#pragma unroll
+        for(int wd=0; wd < 8; ++wd) {
+            unsigned int bits = 0;
+            for(int k=0; k < 32; ++k) {
+                const char4 pr = pattern[wd*32 + k];
+                const int ax = px + (int)floor(c*pr.x - s*pr.y + 0.5f);
+                const int ay = py + (int)floor(s*pr.x + c*pr.y + 0.5f);
+                const int bx = px + (int)floor(c*pr.z - s*pr.w + 0.5f);
+                const int by = py + (int)floor(s*pr.z + c*pr.w + 0.5f);
+                if( img.GetWithClampedRange(ax,ay) < img.GetWithClampedRange(bx,by) ) {
+                    bits |= 1u << k;
+                }
+            }
+            words[wd] = bits;
+        }
+
+        descriptors(i,0) = make_uint4(words[0], words[1], words[2], words[3]);
+        descriptors(i,1) = make_uint4(words[4], words[5], words[6], words[7]);
+    }
+}
+
+template<unsigned Levels>
+void BriefDescriptors(
+    Image<uint4> descriptors, const Image<Keypoint> keypoints, unsigned int num_keypoints,
+    const Pyramid<unsigned char,Levels> pyr, bool oriented
+) {
+    if(num_keypoints == 0) return;
+
+    const Mat<char4,256> pattern = BriefPattern();
+
+    dim3 blockDim(64);
+    dim3 gridDim( ceil(num_keypoints / (double)blockDim.x) );
+    KernBriefDescriptors<Levels><<<gridDim,blockDim>>>(descriptors, keypoints, num_keypoints, pyr, pattern, oriented);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Brute force Hamming matcher
+// Each block loads MatchTile train descriptors into shared memory, against
+// which every thread compares its query descriptor.
+//////////////////////////////////////////////////////
+
+const int MatchTile = 128;
+const int MatchNone = 512;
+
+struct MatchRadiusConstraint
+{
+    inline __device__
+    void SetQuery(const Keypoint& q)
+    {
+        p = make_float2(q.x, q.y);
+    }
+
+    inline __device__
+    bool operator()(const float2 t) const
+    {
+        const float2 d = t - p;
+        return max_radius <= 0 || d.x*d.x + d.y*d.y <= max_radius*max_radius;
+    }
+
+    float max_radius;
+    float2 p;
+};
+
+struct MatchEpipolarConstraint
+{
+    inline __device__
+    void SetQuery(const Keypoint& q)
+    {
+        l = make_float3(
+            F(0,0)*q.x + F(0,1)*q.y + F(0,2),
+            F(1,0)*q.x + F(1,1)*q.y + F(1,2),
+            F(2,0)*q.x + F(2,1)*q.y + F(2,2)
+        );
+        l /= sqrtf(l.x*l.x + l.y*l.y);
+    }
+
+    inline __device__
+    bool operator()(const float2 t) const
+    {
+        return fabs(l.x*t.x + l.y*t.y + l.z) <= max_epipolar_dist;
+    }
+
+    Mat<float,3,3> F;
+    float max_epipolar_dist;
+    float3 l;
+};
+
+template<typename Constraint>
+__global__ void KernMatchDescriptors(
+    Image<int2> matches,
+    const Image<uint4> query_desc, const Image<Keypoint> query_kps, unsigned int num_query,
+    const Image<uint4> train_desc, const Image<Keypoint> train_kps, unsigned int num_train,
+    Constraint constraint, int max_distance, float ratio
+) {
+    __shared__ uint4 tile_lo[MatchTile];
+    __shared__ uint4 tile_hi[MatchTile];
+    __shared__ float2 tile_pos[MatchTile];
+
+    const unsigned int i = blockIdx.x*blockDim.x + threadIdx.x;
+    const bool active = i < num_query;
+
+    uint4 qlo = make_uint4(0,0,0,0);
+    uint4 qhi = qlo;
+    if(active) {
+        qlo = query_desc(i,0);
+        qhi = query_desc(i,1);
+        constraint.SetQuery(query_kps(i,0));
+    }
+
+    int best = MatchNone;
+    int second = MatchNone;
+    int best_idx = -1;
+
+    for(unsigned int t0=0; t0 < num_train; t0 += MatchTile) {
+        __syncthreads();
+        const unsigned int t = t0 + threadIdx.x;
+        if(t < num_train) {
+            const Keypoint kp = train_kps(t,0);
+            tile_lo[threadIdx.x] = train_desc(t,0);
+            tile_hi[threadIdx.x] = train_desc(t,1);
+            tile_pos[threadIdx.x] = make_float2(kp.x, kp.y);
+        }
+        __syncthreads();
+
+        if(active) {
+            const int n = min(MatchTile, (int)(num_train - t0));
+            for(int j=0; j < n; ++j) {
+                if( constraint(tile_pos[j]) ) {
+                    const int d = HammingDistance(qlo, tile_lo[j]) + HammingDistance(qhi, tile_hi[j]);
+                    if(d < best) {
+                        second = best;
+                        best = d;
+                        best_idx = t0 + j;
+                    }else if(d < second) {
+                        second = d;
+                    }
+                }
+            }
+        }
+    }
+
+    if(active) {
+        const bool good = best_idx >= 0 && best <= max_distance && best < ratio * second;
+        matches(i,0) = make_int2(good ? best_idx : -1, best);
+    }
+}
+
+void MatchDescriptors(
+    Image<int2> matches,
+    const Image<uint4> query_desc, const Image<Keypoint> query_kps, unsigned int num_query,
+    const Image<uint4> train_desc, const Image<Keypoint> train_kps, unsigned int num_train,
+    int max_distance, float ratio, float max_radius
+) {
+    if(num_query == 0) return;
+
+    MatchRadiusConstraint constraint;
+    constraint.max_radius = max_radius;
+
+    dim3 blockDim(MatchTile);
+    dim3 gridDim( ceil(num_query / (double)blockDim.x) );
+    KernMatchDescriptors<MatchRadiusConstraint><<<gridDim,blockDim>>>(matches, query_desc, query_kps, num_query, train_desc, train_kps, num_train, constraint, max_distance, ratio);
+    GpuCheckErrors();
+}
+
+void MatchDescriptors(
+    Image<int2> matches,
+    const Image<uint4> query_desc, const Image<Keypoint> query_kps, unsigned int num_query,
+    const Image<uint4> train_desc, const Image<Keypoint> train_kps, unsigned int num_train,
+    const Mat<float,3,3> F, float max_epipolar_dist, int max_distance, float ratio
+) {
+    if(num_query == 0) return;
+
+    MatchEpipolarConstraint constraint;
+    constraint.F = F;
+    constraint.max_epipolar_dist = max_epipolar_dist;
+
+    dim3 blockDim(MatchTile);
+    dim3 gridDim( ceil(num_query / (double)blockDim.x) );
+    KernMatchDescriptors<MatchEpipolarConstraint><<<gridDim,blockDim>>>(matches, query_desc, query_kps, num_query, train_desc, train_kps, num_train, constraint, max_distance, ratio);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT void BriefDescriptors<1>(Image<uint4>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,1>, bool);
+template KANGAROO_EXPORT void BriefDescriptors<2>(Image<uint4>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,2>, bool);
+template KANGAROO_EXPORT void BriefDescriptors<3>(Image<uint4>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,3>, bool);
+template KANGAROO_EXPORT void BriefDescriptors<4>(Image<uint4>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,4>, bool);
+
+}
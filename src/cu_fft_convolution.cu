@@ -0,0 +1,245 @@
+#include "cu_fft_convolution.h"
+#include "cu_convolution.h"
+
+#include "launch_utils.h"
+
+#include <sstream>
+
+namespace roo
+{
+
+inline void CufftCheckSuccess(cufftResult res, const char* what)
+{
+    if(res != CUFFT_SUCCESS) {
+        std::ostringstream ss;
+        ss << what << " (cufftResult " << (int)res << ")";
+        throw CudaException(ss.str());
+    }
+}
+
+//////////////////////////////////////////////////////
+// Padded size with small prime factors for fast FFT
+//////////////////////////////////////////////////////
+
+inline unsigned FftSize(unsigned n)
+{
+    for(;; ++n) {
+        unsigned m = n;
+        while(m % 2 == 0) m /= 2;
+        while(m % 3 == 0) m /= 3;
+        while(m % 5 == 0) m /= 5;
+        while(m % 7 == 0) m /= 7;
+        if(m == 1) return n;
+    }
+}
+
+//////////////////////////////////////////////////////
+// Pad image with Neumann reflection
+// Columns [w, w+px) hold the right border, the rest wrap to the left
+// border. Only px columns either side are read by the valid region, so
+// reflection beyond that is clamped. Rows likewise with py.
+//////////////////////////////////////////////////////
+
+__global__ void KernFftPadNeumann(Image<float> pad, Image<float> in, int px, int py)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if(x < pad.w && y < pad.h) {
+        const int sx = x < (int)in.w + px ? x : max(x - (int)pad.w, -px);
+        const int sy = y < (int)in.h + py ? y : max(y - (int)pad.h, -py);
+        pad(x,y) = in.GetConditionNeumann(sx,sy);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Place kernel origin at (0,0) with wrap around
+//////////////////////////////////////////////////////
+
+__global__ void KernFftPadKernel(Image<float> pad, Image<float> kern, int kx, int ky, float scale)
+{
+    const int c = blockIdx.x*blockDim.x + threadIdx.x;
+    const int r = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if(c < kern.w && r < kern.h) {
+        const int x = (c - kx + (int)pad.w) % (int)pad.w;
+        const int y = (r - ky + (int)pad.h) % (int)pad.h;
+        pad(x,y) = scale * kern(c,r);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Flip kernel for adjoint on direct path
+//////////////////////////////////////////////////////
+
+__global__ void KernFlip(Image<float> out, Image<float> in)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if(x < in.w && y < in.h) {
+        out(in.w-1-x, in.h-1-y) = in(x,y);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Pointwise spectrum product
+// Convolution() is a correlation, so the forward operator multiplies by
+// the conjugate kernel spectrum and the adjoint by the spectrum itself.
+//////////////////////////////////////////////////////
+
+__global__ void KernFftMultiply(cufftComplex* spec, const cufftComplex* kspec, int n, bool conjugate)
+{
+    const int i = blockIdx.x*blockDim.x + threadIdx.x;
+
+    if(i < n) {
+        const cufftComplex a = spec[i];
+        cufftComplex b = kspec[i];
+        if(conjugate) b.y = -b.y;
+        spec[i] = make_float2(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Crop valid region from padded result
+//////////////////////////////////////////////////////
+
+__global__ void KernFftCrop(Image<float> out, Image<float> pad)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if(x < out.w && y < out.h) {
+        out(x,y) = pad(x,y);
+    }
+}
+
+//////////////////////////////////////////////////////
+// ConvolutionPlan
+//////////////////////////////////////////////////////
+
+ConvolutionPlan::ConvolutionPlan()
+    : w(0), h(0), W(0), H(0), kx(0), ky(0), use_fft(false),
+      plan_r2c(0), plan_c2r(0), dPad(0), dSpec(0), dKernSpec(0)
+{
+}
+
+ConvolutionPlan::~ConvolutionPlan()
+{
+    ReleasePlan();
+}
+
+void ConvolutionPlan::ReleasePlan()
+{
+    // Plans exist whenever W is set.
+    if(W) {
+        cufftDestroy(plan_r2c);
+        cufftDestroy(plan_c2r);
+        cudaFree(dPad);
+        cudaFree(dSpec);
+        cudaFree(dKernSpec);
+        dPad = 0;
+        dSpec = 0;
+        dKernSpec = 0;
+    }
+    W = 0;
+    H = 0;
+}
+
+void ConvolutionPlan::SetKernel(Image<float> k, int kx, int ky, unsigned w, unsigned h)
+{
+    this->w = w;
+    this->h = h;
+    this->kx = kx;
+    this->ky = ky;
+
+    // Device copies of kernel for direct path
+    if(kern.w != k.w || kern.h != k.h) {
+        Image<float,TargetDevice,Manage> nk(k.w,k.h);
+        Image<float,TargetDevice,Manage> nkf(k.w,k.h);
+        kern.Swap(nk);
+        kernflip.Swap(nkf);
+    }
+    kern.CopyFrom(k);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, k, 16, 16);
+    KernFlip<<<gridDim,blockDim>>>(kernflip, kern);
+    GpuCheckErrors();
+
+    use_fft = (int)k.Area() > DirectMaxArea;
+    if(!use_fft) return;
+
+    // The forward operator reads kx left and k.w-1-kx right of each pixel,
+    // the adjoint the reverse. Padding the larger on both sides keeps wrap
+    // around out of the valid region for off-centre origins.
+    const unsigned nW = FftSize(w + 2*PadX());
+    const unsigned nH = FftSize(h + 2*PadY());
+
+    if(nW != W || nH != H) {
+        ReleasePlan();
+
+        CufftCheckSuccess( cufftPlan2d(&plan_r2c, nH, nW, CUFFT_R2C), "Unable to cufftPlan2d in ConvolutionPlan::SetKernel" );
+        const cufftResult res = cufftPlan2d(&plan_c2r, nH, nW, CUFFT_C2R);
+        if(res != CUFFT_SUCCESS) {
+            cufftDestroy(plan_r2c);
+            CufftCheckSuccess( res, "Unable to cufftPlan2d in ConvolutionPlan::SetKernel" );
+        }
+
+        W = nW;
+        H = nH;
+        const size_t nspec = H*(W/2+1);
+        GpuCheckSuccess( cudaMalloc(&dPad, W*H*sizeof(float)) );
+        GpuCheckSuccess( cudaMalloc(&dSpec, nspec*sizeof(cufftComplex)) );
+        GpuCheckSuccess( cudaMalloc(&dKernSpec, nspec*sizeof(cufftComplex)) );
+    }
+
+    // Normalise by kernel sum (as direct path) and inverse FFT size.
+    Image<float,TargetHost,Manage> hk(k.w, k.h);
+    hk.CopyFrom(k);
+    float kernsum = 0;
+    for(unsigned r=0; r < hk.h; ++r) {
+        for(unsigned c=0; c < hk.w; ++c) {
+            kernsum += hk(c,r);
+        }
+    }
+
+    Image<float> pad(dPad, W, H);
+    pad.Memset(0);
+    KernFftPadKernel<<<gridDim,blockDim>>>(pad, kern, kx, ky, 1.0f / (kernsum * W * H));
+    GpuCheckErrors();
+    CufftCheckSuccess( cufftExecR2C(plan_r2c, dPad, dKernSpec), "Unable to cufftExecR2C in ConvolutionPlan::SetKernel" );
+}
+
+void ConvolutionPlan::Convolve(Image<float> out, Image<float> in, bool adjoint)
+{
+    if(!use_fft) {
+        if(adjoint) {
+            Convolution<float,float,float,float>(out, in, kernflip, kern.w-1-kx, kern.h-1-ky);
+        }else{
+            Convolution<float,float,float,float>(out, in, kern, kx, ky);
+        }
+        return;
+    }
+
+    Image<float> pad(dPad, W, H);
+    dim3 blockDim, gridDim;
+
+    InitDimFromOutputImageOver(blockDim,gridDim, pad, 16, 16);
+    KernFftPadNeumann<<<gridDim,blockDim>>>(pad, in, PadX(), PadY());
+    GpuCheckErrors();
+
+    CufftCheckSuccess( cufftExecR2C(plan_r2c, dPad, dSpec), "Unable to cufftExecR2C in ConvolutionPlan::Convolve" );
+
+    const int nspec = H*(W/2+1);
+    KernFftMultiply<<<(nspec+255)/256, 256>>>(dSpec, dKernSpec, nspec, !adjoint);
+    GpuCheckErrors();
+
+    CufftCheckSuccess( cufftExecC2R(plan_c2r, dSpec, dPad), "Unable to cufftExecC2R in ConvolutionPlan::Convolve" );
+
+    InitDimFromOutputImageOver(blockDim,gridDim, out, 16, 16);
+    KernFftCrop<<<gridDim,blockDim>>>(out, pad);
+    GpuCheckErrors();
+}
+
+}
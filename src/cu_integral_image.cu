@@ -45,6 +45,7 @@ void Transpose(Image<Tout> out, Image<Tin> in)
 template KANGAROO_EXPORT void Transpose(Image<unsigned char>,Image<unsigned char>);
 template KANGAROO_EXPORT void Transpose(Image<int>,Image<int>);
 template KANGAROO_EXPORT void Transpose(Image<float>,Image<float>);
+template KANGAROO_EXPORT void Transpose(Image<double>,Image<double>);
 
 //////////////////////////////////////////////////////
 // PrefixSum
@@ -121,6 +122,8 @@ void PrefixSumRows(Image<Tout> out, Image<Tin> in)
 template KANGAROO_EXPORT void PrefixSumRows(Image<int>, Image<unsigned char>);
 template KANGAROO_EXPORT void PrefixSumRows(Image<int>, Image<int>);
 template KANGAROO_EXPORT void PrefixSumRows(Image<float>, Image<float>);
+template KANGAROO_EXPORT void PrefixSumRows(Image<double>, Image<float>);
+template KANGAROO_EXPORT void PrefixSumRows(Image<double>, Image<double>);
 
 //////////////////////////////////////////////////////
 // Large Radius Box Filter using Integral Image
@@ -0,0 +1,162 @@
+#include "cu_klt.h"
+
+#include "MatUtils.h"
+#include "launch_utils.h"
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Pyramidal Lucas-Kanade
+// One block per keypoint, one thread per window pixel. Each thread holds
+// its template intensity and gradient for the current level in registers,
+// so only next is sampled per iteration. Normal equations are summed with
+// a shared memory tree reduction, so every thread takes the same path.
+//////////////////////////////////////////////////////
+
+const int KltBlock = 16;
+const int KltThreads = KltBlock*KltBlock;
+
+// Minimum eigen value of structure tensor per window pixel
+const float KltMinEigen = 1E-3;
+
+template<typename T>
+__device__ inline
+T KltBlockSum(T* sReduce, T v)
+{
+    const int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    __syncthreads();
+    sReduce[tid] = v;
+    __syncthreads();
+    for(int S=KltThreads/2; S>0; S>>=1) {
+        if(tid < S) {
+            sReduce[tid] += sReduce[tid+S];
+        }
+        __syncthreads();
+    }
+    return sReduce[0];
+}
+
+template<unsigned Levels>
+__global__ void KernKltTrack(
+    Image<float2> tracked, Image<unsigned char> status,
+    const Image<Keypoint> keypoints,
+    const Pyramid<unsigned char,Levels> prev, const Pyramid<unsigned char,Levels> next,
+    int win_rad, int max_its, float eps, float max_residual
+) {
+    __shared__ float3 sG[KltThreads];
+    __shared__ float2 sb[KltThreads];
+
+    const unsigned int i = blockIdx.x;
+    const int ox = (int)threadIdx.x - win_rad;
+    const int oy = (int)threadIdx.y - win_rad;
+    const bool inwin = ox <= win_rad && oy <= win_rad;
+    const float npix = (2*win_rad+1)*(2*win_rad+1);
+
+    const Keypoint kp = keypoints(i,0);
+
+    // Displacement estimate at current level
+    float2 g = make_float2(0,0);
+    bool good = true;
+    float residual = 0;
+
+    for(int l=Levels-1; l >= 0 && good; --l) {
+        const Image<unsigned char> I = prev.imgs[l];
+        const Image<unsigned char> J = next.imgs[l];
+        const float s = 1.0f / (1 << l);
+        const float2 p = make_float2( (kp.x + 0.5f)*s - 0.5f, (kp.y + 0.5f)*s - 0.5f );
+
+        if( !I.InBounds(p.x, p.y, win_rad+2) ) {
+            // Window doesn't fit at this level, defer to finer levels
+            good = l > 0;
+            g = g * 2.0f;
+            continue;
+        }
+
+        // Template and its gradient, fixed for this level
+        float T = 0;
+        float Ix = 0;
+        float Iy = 0;
+        if(inwin) {
+            T = I.template GetBilinear<float>(p.x+ox, p.y+oy);
+            const Mat<float,1,2> dI = I.template GetCentralDiff<float>(p.x+ox, p.y+oy);
+            Ix = dI(0);
+            Iy = dI(1);
+        }
+
+        const float3 G = KltBlockSum(sG, make_float3(Ix*Ix, Ix*Iy, Iy*Iy));
+        const float det = G.x*G.z - G.y*G.y;
+        const float min_eigen = (G.x + G.z - sqrtf((G.x-G.z)*(G.x-G.z) + 4*G.y*G.y)) / 2;
+        if( min_eigen < KltMinEigen * npix ) {
+            good = false;
+            break;
+        }
+
+        float2 d = make_float2(0,0);
+        for(int it=0; it < max_its; ++it) {
+            const float2 q = p + g + d;
+            if( !J.InBounds(q.x, q.y, win_rad+1) ) {
+                good = false;
+                break;
+            }
+
+            float e = 0;
+            if(inwin) {
+                e = T - J.template GetBilinear<float>(q.x+ox, q.y+oy);
+            }
+
+            const float2 b = KltBlockSum(sb, make_float2(Ix*e, Iy*e));
+            const float2 delta = make_float2( (G.z*b.x - G.y*b.y) / det, (G.x*b.y - G.y*b.x) / det );
+            d += delta;
+
+            if( dot(delta,delta) < eps*eps ) {
+                break;
+            }
+        }
+
+        g = g + d;
+
+        if(l > 0) {
+            g = g * 2.0f;
+        }else if(good) {
+            // Mean absolute error at final position
+            const float2 q = p + g;
+            float e = 0;
+            if(inwin && J.InBounds(q.x, q.y, win_rad+1)) {
+                e = fabs(T - J.template GetBilinear<float>(q.x+ox, q.y+oy));
+            }
+            residual = KltBlockSum(sb, make_float2(e, 0)).x / npix;
+        }
+    }
+
+    if(threadIdx.x == 0 && threadIdx.y == 0) {
+        tracked(i,0) = make_float2(kp.x + g.x, kp.y + g.y);
+        status(i,0) = (good && residual <= max_residual) ? 1 : 0;
+    }
+}
+
+template<unsigned Levels>
+void KltTrack(
+    Image<float2> tracked, Image<unsigned char> status,
+    const Image<Keypoint> keypoints, unsigned int num_keypoints,
+    const Pyramid<unsigned char,Levels> prev, const Pyramid<unsigned char,Levels> next,
+    int win_rad, int max_its, float eps, float max_residual
+) {
+    if(num_keypoints == 0) return;
+
+    dim3 blockDim(KltBlock, KltBlock);
+    dim3 gridDim(num_keypoints);
+    KernKltTrack<Levels><<<gridDim,blockDim>>>(tracked, status, keypoints, prev, next, min(win_rad, (KltBlock-1)/2), max_its, eps, max_residual);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT void KltTrack<1>(Image<float2>, Image<unsigned char>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,1>, const Pyramid<unsigned char,1>, int, int, float, float);
+template KANGAROO_EXPORT void KltTrack<2>(Image<float2>, Image<unsigned char>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,2>, const Pyramid<unsigned char,2>, int, int, float, float);
+template KANGAROO_EXPORT void KltTrack<3>(Image<float2>, Image<unsigned char>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,3>, const Pyramid<unsigned char,3>, int, int, float, float);
+template KANGAROO_EXPORT void KltTrack<4>(Image<float2>, Image<unsigned char>, const Image<Keypoint>, unsigned int, const Pyramid<unsigned char,4>, const Pyramid<unsigned char,4>, int, int, float, float);
+
+}
@@ -80,6 +80,45 @@ void CreateMatlabLookupTable(
     KernCreateMatlabLookupTable<<<gridDim,blockDim>>>(lookup,fu,fv,u0,v0,k1,k2,H_on);
 }
 
+//////////////////////////////////////////////////////
+// Create lookup table from camera model
+//////////////////////////////////////////////////////
+
+__global__ void KernCreateLookupTable(
+    Image<float2> lookup, const CameraModel cam, const Mat<float,3,3> H_on
+) {
+    const uint x = blockIdx.x*blockDim.x + threadIdx.x;
+    const uint y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( lookup.InBounds(x,y) ) {
+        const float3 r_o = make_float3(
+            H_on(0,0)*x + H_on(0,1)*y + H_on(0,2),
+            H_on(1,0)*x + H_on(1,1)*y + H_on(1,2),
+            H_on(2,0)*x + H_on(2,1)*y + H_on(2,2)
+        );
+        lookup(x,y) = ClampLookup(cam.Project(r_o), lookup.w, lookup.h);
+    }
+}
+
+void CreateLookupTable(
+    Image<float2> lookup, const CameraModel& cam, const ImageIntrinsics& K_new, const Mat<float,3,3> R_on
+) {
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, lookup);
+    KernCreateLookupTable<<<gridDim,blockDim>>>(lookup, cam, LookupRayMatrix(K_new, R_on));
+    GpuCheckErrors();
+}
+
+void CreateLookupTable(Image<float2> lookup, const CameraModel& cam, const ImageIntrinsics& K_new)
+{
+    CreateLookupTable(lookup, cam, K_new, MatId<float,3>());
+}
+
+void CreateLookupTable(Image<float2> lookup, const CameraModel& cam)
+{
+    CreateLookupTable(lookup, cam, cam.Intrinsics(), MatId<float,3>());
+}
+
 //////////////////////////////////////////////////////
 // Warp image using lookup table
 //////////////////////////////////////////////////////
@@ -106,4 +145,95 @@ void Warp(
 
 }
 
+//////////////////////////////////////////////////////
+// Fixed point lookup table
+//////////////////////////////////////////////////////
+
+__global__ void KernCreateFixedLookupTable(
+    Image<WarpLookup> fixed, const Image<float2> lookup, int in_w, int in_h
+) {
+    const uint x = blockIdx.x*blockDim.x + threadIdx.x;
+    const uint y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( fixed.InBounds(x,y) ) {
+        fixed(x,y) = MakeWarpLookup(lookup(x,y), in_w, in_h);
+    }
+}
+
+void CreateFixedLookupTable(
+    Image<WarpLookup> fixed, const Image<float2> lookup, int in_w, int in_h
+) {
+    assert(fixed.w <= lookup.w && fixed.h <= lookup.h);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, fixed);
+    KernCreateFixedLookupTable<<<gridDim,blockDim>>>(fixed, lookup, in_w, in_h);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Warp images using fixed point lookup table
+// blockIdx.z selects the image of a stereo pair.
+//////////////////////////////////////////////////////
+
+template<typename T>
+__global__ void KernWarpFixed(
+    Image<T> out0, Image<T> out1, const Image<T> in0, const Image<T> in1,
+    const Image<WarpLookup> lookup0, const Image<WarpLookup> lookup1
+) {
+    const uint x = blockIdx.x*blockDim.x + threadIdx.x;
+    const uint y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    Image<T>& out = blockIdx.z ? out1 : out0;
+    const Image<T>& in = blockIdx.z ? in1 : in0;
+    const Image<WarpLookup>& lookup = blockIdx.z ? lookup1 : lookup0;
+
+    if( out.InBounds(x,y) ) {
+        out(x,y) = WarpSample(in, lookup(x,y));
+    }
+}
+
+template<typename T>
+void Warp(
+    Image<T> out, const Image<T> in, const Image<WarpLookup> lookup
+) {
+    assert(out.w <= lookup.w && out.h <= lookup.h);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, out);
+    KernWarpFixed<T><<<gridDim,blockDim>>>(out, out, in, in, lookup, lookup);
+    GpuCheckErrors();
+}
+
+template<typename T>
+void Warp(
+    Image<T> out_left, Image<T> out_right,
+    const Image<T> in_left, const Image<T> in_right,
+    const Image<WarpLookup> lookup_left, const Image<WarpLookup> lookup_right
+) {
+    assert(out_left.w == out_right.w && out_left.h == out_right.h);
+    assert(out_left.w <= lookup_left.w && out_left.h <= lookup_left.h);
+    assert(out_right.w <= lookup_right.w && out_right.h <= lookup_right.h);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, out_left);
+    gridDim.z = 2;
+    KernWarpFixed<T><<<gridDim,blockDim>>>(out_left, out_right, in_left, in_right, lookup_left, lookup_right);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT void Warp<unsigned char>(Image<unsigned char>, const Image<unsigned char>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<uchar3>(Image<uchar3>, const Image<uchar3>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<uchar4>(Image<uchar4>, const Image<uchar4>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<float>(Image<float>, const Image<float>, const Image<WarpLookup>);
+
+template KANGAROO_EXPORT void Warp<unsigned char>(Image<unsigned char>, Image<unsigned char>, const Image<unsigned char>, const Image<unsigned char>, const Image<WarpLookup>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<uchar3>(Image<uchar3>, Image<uchar3>, const Image<uchar3>, const Image<uchar3>, const Image<WarpLookup>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<uchar4>(Image<uchar4>, Image<uchar4>, const Image<uchar4>, const Image<uchar4>, const Image<WarpLookup>, const Image<WarpLookup>);
+template KANGAROO_EXPORT void Warp<float>(Image<float>, Image<float>, const Image<float>, const Image<float>, const Image<WarpLookup>, const Image<WarpLookup>);
+
 }
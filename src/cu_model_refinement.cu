@@ -538,17 +538,16 @@ LeastSquaresSystem<float,6> CalibrationRgbdFromDepthESM(
 // Projective ICP with Point Plane constraint
 //////////////////////////////////////////////////////
 
-__global__ void KernPoseRefinementProjectiveIcpPointPlane(
-    const Image<float4> dPl,
-    const Image<float4> dPr, const Image<float4> dNr,
-    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl, float c,
-    Image<LeastSquaresSystem<float,6> > dSum, Image<float4> dDebug
+template<typename Robust>
+__device__ inline
+void BuildPoseRefinementProjectiveIcpPointPlaneSystem(
+    const unsigned int u,  const unsigned int v,
+    const Image<float4>& dPl,
+    const Image<float4>& dPr, const Image<float4>& dNr,
+    const Mat<float,3,4>& KT_lr, const Mat<float,3,4>& T_rl, float c,
+    IcpStatistics& stats, Image<float4>& dDebug
 ) {
-    const unsigned int u = blockIdx.x*blockDim.x + threadIdx.x;
-    const unsigned int v = blockIdx.y*blockDim.y + threadIdx.y;
-
-    __shared__ SumLeastSquaresSystem<float,6,16,16> sumlss;
-    LeastSquaresSystem<float,6>& sum = sumlss.ZeroThisObs();
+    LeastSquaresSystem<float,6>& sum = stats.lss;
 
     const float4 Pr = dPr(u,v);
     const float4 Nr = dNr(u,v);
@@ -574,13 +573,17 @@ __global__ void KernPoseRefinementProjectiveIcpPointPlane(
                 -dot(SE3gen5mul(_Pr), Nr)
             };
 
-            const float w = (1.0f/Pr.z) * LSReweightTukey(y,c);
+            const float w = (1.0f/Pr.z) * Robust::Weight(y,c);
             sum.JTJ = OuterProduct(Jr,w);
             sum.JTy = mul_aTb(Jr,y*w);
             sum.obs = 1;
             sum.sqErr = y*y;
 
             const float db = fabs(y);
+            stats.wSqErr = w*y*y;
+            stats.inliers = db <= c ? 1 : 0;
+            stats.hist[ min( (int)(db * (IcpHistogramBins/2) / c), IcpHistogramBins-1) ] = 1;
+
             dDebug(u,v) = make_float4(db,db,db,1);
         }else{
             dDebug(u,v) = make_float4(0,0,1,1);
@@ -588,10 +591,38 @@ __global__ void KernPoseRefinementProjectiveIcpPointPlane(
     }else{
         dDebug(u,v) = make_float4(1,0,0,1);
     }
+}
 
-    sumlss.ReducePutBlock(dSum);
+template<typename Robust>
+__global__ void KernPoseRefinementProjectiveIcpPointPlane(
+    const Image<float4> dPl,
+    const Image<float4> dPr, const Image<float4> dNr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl, float c,
+    Image<IcpStatistics> dSum, Image<float4> dDebug
+) {
+    const unsigned int u = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int v = blockIdx.y*blockDim.y + threadIdx.y;
+
+    __shared__ SumBlocks<IcpStatistics,16,16> sumstats;
+    IcpStatistics& stats = sumstats.ZeroThisObs();
+    BuildPoseRefinementProjectiveIcpPointPlaneSystem<Robust>(u,v, dPl, dPr, dNr, KT_lr, T_rl, c, stats, dDebug);
+    sumstats.ReducePutBlock(dSum);
 }
 
+template<typename Robust>
+IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust(
+    const Image<float4> dPl,
+    const Image<float4> dPr, const Image<float4> dNr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl, float c,
+    Image<unsigned char> dWorkspace, Image<float4> dDebug
+){
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImage(blockDim, gridDim, dPl, 16, 16);
+
+    HostSumBlocks<IcpStatistics> stats(dWorkspace, blockDim, gridDim);
+    KernPoseRefinementProjectiveIcpPointPlane<Robust><<<gridDim,blockDim>>>(dPl, dPr, dNr, KT_lr, T_rl, c, stats.SumImage(), dDebug );
+    return stats.FinalSum();
+}
 
 LeastSquaresSystem<float,6> PoseRefinementProjectiveIcpPointPlane(
     const Image<float4> dPl,
@@ -599,14 +630,264 @@ LeastSquaresSystem<float,6> PoseRefinementProjectiveIcpPointPlane(
     const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl, float c,
     Image<unsigned char> dWorkspace, Image<float4> dDebug
 ){
+    return PoseRefinementProjectiveIcpPointPlaneRobust<RobustTukey>(dPl, dPr, dNr, KT_lr, T_rl, c, dWorkspace, dDebug).lss;
+}
+
+//////////////////////////////////////////////////////
+// Joint projective ICP and photometric alignment
+//////////////////////////////////////////////////////
+
+template<typename Robust, typename Ti>
+__global__ void KernPoseRefinementProjectiveRgbd(
+    const Image<float4> dPl, const Image<Ti> dIl,
+    const Image<float4> dPr, const Image<float4> dNr, const Image<Ti> dIr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl,
+    float c_geom, float c_photo, float lambda_photo,
+    Image<RgbdStatistics> dSum, Image<float4> dDebug
+) {
+    const unsigned int u = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int v = blockIdx.y*blockDim.y + threadIdx.y;
+
+    __shared__ SumBlocks<RgbdStatistics,16,16> sumstats;
+    RgbdStatistics& sum = sumstats.ZeroThisObs();
+
+    const float4 Pr = dPr(u,v);
+    const float3 KPl = KT_lr * Pr;
+    const float2 pl = dn(KPl);
+
+    float4 debug = make_float4(1,0,0,1);
+
+    if( isfinite(Pr.z) && dIl.InBounds(pl, 3) ) {
+        debug = make_float4(0,0,1,1);
+
+        // Point-plane term
+        const float4 Nr = dNr(u,v);
+        const float4 _Pl = dPl.GetNearestNeighbour(pl);
+        if( Nr.w == 1.0f && isfinite(_Pl.z) ) {
+            const float3 _Pr = T_rl * _Pl;
+            const float y = dot(_Pr - Pr, Nr);
+
+            const Mat<float,1,6> Jr = {
+                -dot(SE3gen0mul(_Pr), Nr),
+                -dot(SE3gen1mul(_Pr), Nr),
+                -dot(SE3gen2mul(_Pr), Nr),
+                -dot(SE3gen3mul(_Pr), Nr),
+                -dot(SE3gen4mul(_Pr), Nr),
+                -dot(SE3gen5mul(_Pr), Nr)
+            };
+
+            const float w = (1.0f/Pr.z) * Robust::Weight(y,c_geom);
+            sum.lss.JTJ = OuterProduct(Jr,w);
+            sum.lss.JTy = mul_aTb(Jr,y*w);
+            sum.lss.sqErr = y*y;
+            sum.lss.obs = 1;
+            sum.sqErrGeom = y*y;
+            sum.obsGeom = 1;
+            debug.x = fabs(y);
+        }
+
+        // Intensity term, forward compositional on live image
+        const float Il = dIl.template GetBilinear<float>(pl);
+        const float Ir = dIr(u,v);
+        const float y = Il - Ir;
+
+        const Mat<float,1,2> dIl_dpl = dIl.template GetCentralDiff<float>(pl.x, pl.y);
+        const Mat<float,2,3> dpl_dKPl = {{
+          1.0f/KPl.z, 0, -KPl.x/(KPl.z*KPl.z),
+          0, 1.0f/KPl.z, -KPl.y/(KPl.z*KPl.z)
+        }};
+        const Mat<float,1,4> dIldPlKT_lr = dIl_dpl * dpl_dKPl * KT_lr;
+
+        // Sparse J_i = dIldPlKT_lr * gen_i * Pr
+        const Mat<float,1,6> Ji = {{
+            dIldPlKT_lr(0),
+            dIldPlKT_lr(1),
+            dIldPlKT_lr(2),
+            -dIldPlKT_lr(1)*Pr.z + dIldPlKT_lr(2)*Pr.y,
+            +dIldPlKT_lr(0)*Pr.z - dIldPlKT_lr(2)*Pr.x,
+            -dIldPlKT_lr(0)*Pr.y + dIldPlKT_lr(1)*Pr.x
+        }};
+
+        const float w = lambda_photo * Robust::Weight(y,c_photo);
+        sum.lss.JTJ += OuterProduct(Ji,w);
+        sum.lss.JTy += mul_aTb(Ji,y*w);
+        sum.lss.sqErr += lambda_photo*y*y;
+        sum.lss.obs += 1;
+        sum.sqErrPhoto = y*y;
+        sum.obsPhoto = 1;
+        debug.y = fabs(y) / c_photo;
+    }
+
+    dDebug(u,v) = debug;
+    sumstats.ReducePutBlock(dSum);
+}
+
+template<typename Robust, typename Ti>
+RgbdStatistics PoseRefinementProjectiveRgbd(
+    const Image<float4> dPl, const Image<Ti> dIl,
+    const Image<float4> dPr, const Image<float4> dNr, const Image<Ti> dIr,
+    const Mat<float,3,4> KT_lr, const Mat<float,3,4> T_rl,
+    float c_geom, float c_photo, float lambda_photo,
+    Image<unsigned char> dWorkspace, Image<float4> dDebug
+) {
     dim3 blockDim, gridDim;
-    InitDimFromOutputImage(blockDim, gridDim, dPl, 16, 16);
+    InitDimFromOutputImage(blockDim, gridDim, dPr, 16, 16);
 
-    HostSumLeastSquaresSystem<float,6> lss(dWorkspace, blockDim, gridDim);
-    KernPoseRefinementProjectiveIcpPointPlane<<<gridDim,blockDim>>>(dPl, dPr, dNr, KT_lr, T_rl, c, lss.LeastSquareImage(), dDebug );
-    return lss.FinalSystem();
+    HostSumBlocks<RgbdStatistics> stats(dWorkspace, blockDim, gridDim);
+    KernPoseRefinementProjectiveRgbd<Robust,Ti><<<gridDim,blockDim>>>(dPl, dIl, dPr, dNr, dIr, KT_lr, T_rl, c_geom, c_photo, lambda_photo, stats.SumImage(), dDebug );
+    return stats.FinalSum();
+}
+
+//////////////////////////////////////////////////////
+// Coarse to fine projective ICP, solved on device
+//////////////////////////////////////////////////////
+
+template<typename Robust>
+__global__ void KernIcpPointPlaneLevel(
+    const Image<float4> dPl,
+    const Image<float4> dPr, const Image<float4> dNr,
+    const ImageIntrinsics K, float c, int level,
+    Image<IcpState> dState, Image<IcpStatistics> dSum, Image<float4> dDebug
+) {
+    const unsigned int u = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int v = blockIdx.y*blockDim.y + threadIdx.y;
+
+    const IcpState& state = dState[0];
+    if(state.done_level == level) return;
+
+    Mat<float,3,4> KT_lr;
+    for(int j=0; j<4; ++j) {
+        KT_lr(0,j) = K.fu*state.T_lr(0,j) + K.u0*state.T_lr(2,j);
+        KT_lr(1,j) = K.fv*state.T_lr(1,j) + K.v0*state.T_lr(2,j);
+        KT_lr(2,j) = state.T_lr(2,j);
+    }
+
+    __shared__ SumBlocks<IcpStatistics,16,16> sumstats;
+    IcpStatistics& stats = sumstats.ZeroThisObs();
+    BuildPoseRefinementProjectiveIcpPointPlaneSystem<Robust>(u,v, dPl, dPr, dNr, KT_lr, state.T_rl, c, stats, dDebug);
+    sumstats.ReducePutBlock(dSum);
+}
+
+// Single block: sum block partials, solve and update pose
+__global__ void KernIcpSolve(
+    Image<IcpStatistics> dSum, unsigned int n, Image<IcpState> dState,
+    int level, bool rotation_only, float prior, float min_step
+) {
+    IcpState& state = dState[0];
+    if(state.done_level == level) return;
+
+    const unsigned int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    __shared__ SumBlocks<IcpStatistics,16,16> sumstats;
+    IcpStatistics& stats = sumstats.ZeroThisObs();
+    for(unsigned int i=tid; i < n; i += blockDim.x*blockDim.y) {
+        stats += dSum[i];
+    }
+    sumstats.ReducePutBlock(dSum);
+
+    if(tid == 0) {
+        const IcpStatistics total = dSum[0];
+        const LeastSquaresSystem<float,6>& lss = total.lss;
+
+        Mat<float,6> x;
+        x.SetZero();
+        bool ok;
+
+        if(rotation_only) {
+            SymMat<float,3> A;
+            Mat<float,3> b, xr;
+            for(int r=0; r<3; ++r) {
+                for(int c=0; c<=r; ++c) {
+                    A.m[r*(r+1)/2 + c] = lss.JTJ.m[(r+3)*(r+4)/2 + c+3] + (r==c ? prior : 0.0f);
+                }
+                b(r) = lss.JTy(r+3);
+            }
+            ok = CholeskySolve(A, b, xr);
+            for(int r=0; r<3; ++r) x(r+3) = -xr(r);
+        }else{
+            SymMat<float,6> A = lss.JTJ;
+            for(int r=0; r<6; ++r) A.m[r*(r+1)/2 + r] += prior;
+            ok = CholeskySolve(A, lss.JTy, x);
+            x = -1.0f * x;
+        }
+
+        if(ok) {
+            state.T_lr = state.T_lr * SE3exp(x);
+            state.T_rl = SE3inv(state.T_lr);
+        }
+
+        state.stats = total;
+        state.its++;
+        if(!ok || sqrtf(x*x) < min_step) {
+            state.done_level = level;
+        }
+    }
+}
+
+template<unsigned Levels, typename Robust>
+IcpState IcpPointPlaneCoarseToFine(
+    const Pyramid<float4,Levels> dPl,
+    const Pyramid<float4,Levels> dPr, const Pyramid<float4,Levels> dNr,
+    const ImageIntrinsics K, const Mat<float,3,4> T_lr, const int its[Levels],
+    float c, float prior, Image<unsigned char> dWorkspace, Image<float4> dDebug,
+    float min_step
+) {
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImage(blockDim, gridDim, dPr.imgs[0], 16, 16);
+    const dim3 solveBlockDim(16,16), solveGridDim(1,1);
+
+    Image<unsigned char> scratch = dWorkspace;
+    Image<IcpState> dState = scratch.SplitAlignedImage<IcpState>(1,1);
+    Image<IcpStatistics> dSum = scratch.SplitAlignedImage<IcpStatistics>(gridDim.x*gridDim.y, 1);
+
+    IcpState state;
+    state.T_lr = T_lr;
+    state.T_rl = SE3inv(T_lr);
+    state.stats.SetZero();
+    state.its = 0;
+    state.done_level = -1;
+    dState.MemcpyFromHost(&state);
+
+    for(int l=Levels-1; l >= 0; --l) {
+        const Image<float4> Pr = dPr.imgs[l];
+        InitDimFromOutputImage(blockDim, gridDim, Pr, 16, 16);
+        const bool rotation_only = Levels > 1 && l == (int)Levels-1;
+
+        for(int i=0; i < its[l]; ++i) {
+            KernIcpPointPlaneLevel<Robust><<<gridDim,blockDim>>>(dPl.imgs[l], Pr, dNr.imgs[l], K[l], c, l, dState, dSum, dDebug.SubImage(Pr.w, Pr.h) );
+            KernIcpSolve<<<solveGridDim,solveBlockDim>>>(dSum, gridDim.x*gridDim.y, dState, l, rotation_only, prior, min_step);
+        }
+    }
+    GpuCheckErrors();
+
+    dState.MemcpyToHost(&state);
+    return state;
 }
 
+template KANGAROO_EXPORT IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust<RobustSq>(const Image<float4>, const Image<float4>, const Image<float4>, const Mat<float,3,4>, const Mat<float,3,4>, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust<RobustHuber>(const Image<float4>, const Image<float4>, const Image<float4>, const Mat<float,3,4>, const Mat<float,3,4>, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust<RobustTukey>(const Image<float4>, const Image<float4>, const Image<float4>, const Mat<float,3,4>, const Mat<float,3,4>, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT IcpStatistics PoseRefinementProjectiveIcpPointPlaneRobust<RobustCauchy>(const Image<float4>, const Image<float4>, const Image<float4>, const Mat<float,3,4>, const Mat<float,3,4>, float, Image<unsigned char>, Image<float4>);
+
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<1,RobustHuber>(const Pyramid<float4,1>, const Pyramid<float4,1>, const Pyramid<float4,1>, const ImageIntrinsics, const Mat<float,3,4>, const int[1], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<1,RobustTukey>(const Pyramid<float4,1>, const Pyramid<float4,1>, const Pyramid<float4,1>, const ImageIntrinsics, const Mat<float,3,4>, const int[1], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<1,RobustCauchy>(const Pyramid<float4,1>, const Pyramid<float4,1>, const Pyramid<float4,1>, const ImageIntrinsics, const Mat<float,3,4>, const int[1], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<2,RobustHuber>(const Pyramid<float4,2>, const Pyramid<float4,2>, const Pyramid<float4,2>, const ImageIntrinsics, const Mat<float,3,4>, const int[2], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<2,RobustTukey>(const Pyramid<float4,2>, const Pyramid<float4,2>, const Pyramid<float4,2>, const ImageIntrinsics, const Mat<float,3,4>, const int[2], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<2,RobustCauchy>(const Pyramid<float4,2>, const Pyramid<float4,2>, const Pyramid<float4,2>, const ImageIntrinsics, const Mat<float,3,4>, const int[2], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<3,RobustHuber>(const Pyramid<float4,3>, const Pyramid<float4,3>, const Pyramid<float4,3>, const ImageIntrinsics, const Mat<float,3,4>, const int[3], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<3,RobustTukey>(const Pyramid<float4,3>, const Pyramid<float4,3>, const Pyramid<float4,3>, const ImageIntrinsics, const Mat<float,3,4>, const int[3], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<3,RobustCauchy>(const Pyramid<float4,3>, const Pyramid<float4,3>, const Pyramid<float4,3>, const ImageIntrinsics, const Mat<float,3,4>, const int[3], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<4,RobustHuber>(const Pyramid<float4,4>, const Pyramid<float4,4>, const Pyramid<float4,4>, const ImageIntrinsics, const Mat<float,3,4>, const int[4], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<4,RobustTukey>(const Pyramid<float4,4>, const Pyramid<float4,4>, const Pyramid<float4,4>, const ImageIntrinsics, const Mat<float,3,4>, const int[4], float, float, Image<unsigned char>, Image<float4>, float);
+template KANGAROO_EXPORT IcpState IcpPointPlaneCoarseToFine<4,RobustCauchy>(const Pyramid<float4,4>, const Pyramid<float4,4>, const Pyramid<float4,4>, const ImageIntrinsics, const Mat<float,3,4>, const int[4], float, float, Image<unsigned char>, Image<float4>, float);
+
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustHuber,unsigned char>(const Image<float4>, const Image<unsigned char>, const Image<float4>, const Image<float4>, const Image<unsigned char>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustTukey,unsigned char>(const Image<float4>, const Image<unsigned char>, const Image<float4>, const Image<float4>, const Image<unsigned char>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustCauchy,unsigned char>(const Image<float4>, const Image<unsigned char>, const Image<float4>, const Image<float4>, const Image<unsigned char>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustHuber,float>(const Image<float4>, const Image<float>, const Image<float4>, const Image<float4>, const Image<float>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustTukey,float>(const Image<float4>, const Image<float>, const Image<float4>, const Image<float4>, const Image<float>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+template KANGAROO_EXPORT RgbdStatistics PoseRefinementProjectiveRgbd<RobustCauchy,float>(const Image<float4>, const Image<float>, const Image<float4>, const Image<float4>, const Image<float>, const Mat<float,3,4>, const Mat<float,3,4>, float, float, float, Image<unsigned char>, Image<float4>);
+
 //////////////////////////////////////////////////////
 // Kinect Calibration
 //////////////////////////////////////////////////////
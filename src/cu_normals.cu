@@ -1,6 +1,8 @@
 #include "cu_normals.h"
 
 #include "launch_utils.h"
+#include "cu_integral_image.h"
+#include "MatUtils.h"
 
 namespace roo
 {
@@ -44,4 +46,133 @@ void NormalsFromVbo(Image<float4> dN, const Image<float4> dV)
     KernNormalsFromVbo<<<gridDim,blockDim>>>(dN, dV);
 }
 
+//////////////////////////////////////////////////////
+// Normals from integral images
+//////////////////////////////////////////////////////
+
+// Channels of per point sums: count, x, y, z, xx, xy, xz, yy, yz, zz,
+// followed by a discontinuity channel, set for points whose right or lower
+// neighbour differs in depth by more than max_depth_change * z.
+const int NormalSumChannels = 10;
+
+__global__ void KernNormalSumChannel(Image<float> out, const Image<float4> dV, int c, float max_depth_change)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( out.InBounds(x,y) ) {
+        float v = 0;
+
+        if( x < dV.w && y < dV.h ) {
+            const float4 P = dV(x,y);
+            if( isfinite(P.z) && P.z > 0 ) {
+                switch(c) {
+                case 0: v = 1;       break;
+                case 1: v = P.x;     break;
+                case 2: v = P.y;     break;
+                case 3: v = P.z;     break;
+                case 4: v = P.x*P.x; break;
+                case 5: v = P.x*P.y; break;
+                case 6: v = P.x*P.z; break;
+                case 7: v = P.y*P.y; break;
+                case 8: v = P.y*P.z; break;
+                case 9: v = P.z*P.z; break;
+                default: {
+                    const float max_dz = max_depth_change * P.z;
+                    if(x+1 < dV.w) {
+                        const float zr = dV(x+1,y).z;
+                        if( isfinite(zr) && fabs(zr - P.z) > max_dz ) v = 1;
+                    }
+                    if(y+1 < dV.h) {
+                        const float zd = dV(x,y+1).z;
+                        if( isfinite(zd) && fabs(zd - P.z) > max_dz ) v = 1;
+                    }
+                }
+                }
+            }
+        }
+
+        out(x,y) = v;
+    }
+}
+
+// Sum of channel c over [x0,x1) x [y0,y1), with transposed integral images
+// of each channel stacked vertically, (dV.w+1) rows apiece.
+inline __device__
+double NormalWindowSum(const Image<double>& dSumsT, int c, int x0, int y0, int x1, int y1)
+{
+    const int r = c * (dSumsT.h / (NormalSumChannels+1));
+    return dSumsT(y1,r+x1) - dSumsT(y0,r+x1) - dSumsT(y1,r+x0) + dSumsT(y0,r+x0);
+}
+
+__global__ void KernNormalsFromIntegral(Image<float4> dN, const Image<float4> dV, const Image<double> dSumsT, float rad, int max_rad)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( dN.InBounds(x,y) ) {
+        float4 N = make_float4(0,0,0,0);
+        const float4 P = dV(x,y);
+
+        if( isfinite(P.z) && P.z > 0 ) {
+            // Shrink window until free of discontinuities
+            int r = max(1, min(max_rad, (int)(rad*P.z + 0.5f)));
+            for(; r > 0; --r) {
+                const double edges = NormalWindowSum(dSumsT, NormalSumChannels,
+                    max(0,x-r), max(0,y-r), min((int)dV.w,x+r), min((int)dV.h,y+r)
+                );
+                if(edges < 0.5) break;
+            }
+
+            if(r > 0) {
+                const int x0 = max(0,x-r);
+                const int y0 = max(0,y-r);
+                const int x1 = min((int)dV.w,x+r+1);
+                const int y1 = min((int)dV.h,y+r+1);
+
+                PlaneMoments m;
+                m.n = NormalWindowSum(dSumsT, 0, x0, y0, x1, y1);
+                for(int i=0; i < 3; ++i) m.s[i] = NormalWindowSum(dSumsT, 1+i, x0, y0, x1, y1);
+                for(int i=0; i < 6; ++i) m.ss[i] = NormalWindowSum(dSumsT, 4+i, x0, y0, x1, y1);
+
+                if(m.n >= 3) {
+                    double mse;
+                    const float4 plane = m.Fit(mse);
+                    N = make_float4(plane.x, plane.y, plane.z, 1);
+                }
+            }
+        }
+
+        dN(x,y) = N;
+    }
+}
+
+void NormalsFromVboIntegral(
+    Image<float4> dN, const Image<float4> dV, Image<unsigned char> dWorkspace,
+    float rad, int max_rad, float max_depth_change
+) {
+    const int w = dV.w + 1;
+    const int h = dV.h + 1;
+
+    Image<unsigned char> scratch = dWorkspace;
+    Image<double> dSumsT = scratch.SplitAlignedImage<double>(h, (NormalSumChannels+1)*w);
+    Image<double> dRows = scratch.SplitAlignedImage<double>(w, h);
+    Image<double> dRowsT = scratch.SplitAlignedImage<double>(h, w);
+    Image<float> dChannel = scratch.SplitAlignedImage<float>(w, h);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dChannel);
+
+    for(int c=0; c <= NormalSumChannels; ++c) {
+        KernNormalSumChannel<<<gridDim,blockDim>>>(dChannel, dV, c, max_depth_change);
+        PrefixSumRows<double,float>(dRows, dChannel);
+        Transpose<double,double>(dRowsT, dRows);
+        PrefixSumRows<double,double>(dSumsT.SubImage(0, c*w, h, w), dRowsT);
+    }
+
+    InitDimFromOutputImageOver(blockDim, gridDim, dN);
+    KernNormalsFromIntegral<<<gridDim,blockDim>>>(dN, dV, dSumsT, rad, max_rad);
+    GpuCheckErrors();
+}
+
 }
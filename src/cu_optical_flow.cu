@@ -0,0 +1,159 @@
+#include "cu_optical_flow.h"
+
+#include "launch_utils.h"
+#include "Pyramid.h"
+#include "reduce.h"
+#include "OpticalFlow.h"
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// TV-L1 optical flow kernels
+// Per pixel operations are shared with the host implementation in
+// OpticalFlowHost.h. The thresholding step is fused with the primal update
+// and both flow components are updated by each kernel.
+//////////////////////////////////////////////////////
+
+__global__ void KernTVL1Linearise(
+    Image<float4> imgdata, const Image<float> img0, const Image<float> img1,
+    const Image<float> imgu1, const Image<float> imgu2
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < imgdata.w && y < imgdata.h ) {
+        imgdata(x,y) = TVL1LineariseData(img0, img1, make_float2(imgu1(x,y), imgu2(x,y)), x, y);
+    }
+}
+
+__global__ void KernTVL1Primal(
+    Image<float> imgu1, Image<float> imgu2,
+    const Image<float2> imgp1, const Image<float2> imgp2, const Image<float4> imgdata,
+    float lambda, float theta
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < imgu1.w && y < imgu1.h ) {
+        TVL1PrimalUpdate(imgu1, imgu2, imgp1, imgp2, imgdata, lambda, theta, x, y);
+    }
+}
+
+__global__ void KernTVL1Dual(
+    Image<float2> imgp1, Image<float2> imgp2,
+    const Image<float> imgu1, const Image<float> imgu2,
+    float tau_theta
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < imgp1.w && y < imgp1.h ) {
+        TVL1DualUpdate(imgp1, imgp2, imgu1, imgu2, tau_theta, x, y);
+    }
+}
+
+__global__ void KernTVL1Upsample(
+    Image<float> imgu1, Image<float> imgu2, Image<float2> imgp1, Image<float2> imgp2,
+    const Image<float> imgu1c, const Image<float> imgu2c, const Image<float2> imgp1c, const Image<float2> imgp2c
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < imgu1.w && y < imgu1.h ) {
+        TVL1Upsample(imgu1, imgu2, imgp1, imgp2, imgu1c, imgu2c, imgp1c, imgp2c, x, y);
+    }
+}
+
+__global__ void KernTVL1Flow(Image<float2> flow, const Image<float> imgu1, const Image<float> imgu2)
+{
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < flow.w && y < flow.h ) {
+        flow(x,y) = make_float2(imgu1(x,y), imgu2(x,y));
+    }
+}
+
+//////////////////////////////////////////////////////
+// Coarse-to-fine TV-L1 optical flow
+//////////////////////////////////////////////////////
+
+template<unsigned Levels>
+void TVL1OpticalFlow(
+    Image<float2> flow, const Image<float> img0, const Image<float> img1,
+    Image<unsigned char> dWorkspace,
+    float lambda, float theta, float tau,
+    int warps, int its_per_warp
+) {
+    const unsigned w = img0.w;
+    const unsigned h = img0.h;
+
+    Image<unsigned char> scratch = dWorkspace;
+    Pyramid<float,Levels> i0pyr, i1pyr, u1pyr, u2pyr;
+    Pyramid<float2,Levels> p1pyr, p2pyr;
+
+    i0pyr.imgs[0] = img0;
+    i1pyr.imgs[0] = img1;
+
+    for(unsigned l=0; l < Levels; ++l) {
+        if(l > 0) {
+            i0pyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+            i1pyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        }
+        u1pyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        u2pyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        p1pyr.imgs[l] = scratch.SplitAlignedImage<float2>(w>>l, h>>l);
+        p2pyr.imgs[l] = scratch.SplitAlignedImage<float2>(w>>l, h>>l);
+    }
+    Image<float4> imgdata = scratch.SplitAlignedImage<float4>(w, h);
+
+    BoxReduce<float,Levels,float>(i0pyr);
+    BoxReduce<float,Levels,float>(i1pyr);
+
+    u1pyr.imgs[Levels-1].Memset(0);
+    u2pyr.imgs[Levels-1].Memset(0);
+    p1pyr.imgs[Levels-1].Memset(0);
+    p2pyr.imgs[Levels-1].Memset(0);
+
+    for(int l=Levels-1; l >= 0; --l) {
+        Image<float> u1 = u1pyr.imgs[l];
+        Image<float> u2 = u2pyr.imgs[l];
+        Image<float2> p1 = p1pyr.imgs[l];
+        Image<float2> p2 = p2pyr.imgs[l];
+        Image<float4> data = imgdata.SubImage(u1.w, u1.h);
+
+        dim3 blockDim, gridDim;
+        InitDimFromOutputImageOver(blockDim,gridDim, u1);
+
+        for(int k=0; k < warps; ++k) {
+            KernTVL1Linearise<<<gridDim,blockDim>>>(data, i0pyr.imgs[l], i1pyr.imgs[l], u1, u2);
+            for(int i=0; i < its_per_warp; ++i) {
+                KernTVL1Primal<<<gridDim,blockDim>>>(u1, u2, p1, p2, data, lambda, theta);
+                KernTVL1Dual<<<gridDim,blockDim>>>(p1, p2, u1, u2, tau / theta);
+            }
+        }
+
+        if(l > 0) {
+            InitDimFromOutputImageOver(blockDim,gridDim, u1pyr.imgs[l-1]);
+            KernTVL1Upsample<<<gridDim,blockDim>>>(u1pyr.imgs[l-1], u2pyr.imgs[l-1], p1pyr.imgs[l-1], p2pyr.imgs[l-1], u1, u2, p1, p2);
+        }
+        GpuCheckErrors();
+    }
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, flow);
+    KernTVL1Flow<<<gridDim,blockDim>>>(flow, u1pyr.imgs[0], u2pyr.imgs[0]);
+    GpuCheckErrors();
+}
+
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT void TVL1OpticalFlow<1>(Image<float2>, const Image<float>, const Image<float>, Image<unsigned char>, float, float, float, int, int);
+template KANGAROO_EXPORT void TVL1OpticalFlow<2>(Image<float2>, const Image<float>, const Image<float>, Image<unsigned char>, float, float, float, int, int);
+template KANGAROO_EXPORT void TVL1OpticalFlow<3>(Image<float2>, const Image<float>, const Image<float>, Image<unsigned char>, float, float, float, int, int);
+template KANGAROO_EXPORT void TVL1OpticalFlow<4>(Image<float2>, const Image<float>, const Image<float>, Image<unsigned char>, float, float, float, int, int);
+
+}
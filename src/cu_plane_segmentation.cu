@@ -0,0 +1,313 @@
+#include "cu_plane_segmentation.h"
+
+#include <vector>
+#include <set>
+#include <queue>
+#include <algorithm>
+
+#include "launch_utils.h"
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Block plane moments
+//////////////////////////////////////////////////////
+
+// One thread per block. Blocks with any missing point are left empty.
+__global__ void KernPlaneBlockMoments(Image<PlaneMoments> dMoments, const Image<float4> dVbo, int block_size)
+{
+    const int bx = blockIdx.x*blockDim.x + threadIdx.x;
+    const int by = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( dMoments.InBounds(bx,by) ) {
+        PlaneMoments m;
+        m.SetZero();
+
+        bool valid = true;
+        for(int y=by*block_size; valid && y < (by+1)*block_size; ++y) {
+            for(int x=bx*block_size; x < (bx+1)*block_size; ++x) {
+                const float4 P = dVbo(x,y);
+                if( !isfinite(P.z) || P.z <= 0 ) {
+                    valid = false;
+                    break;
+                }
+                m.Add(P);
+            }
+        }
+
+        if(!valid) m.SetZero();
+        dMoments(bx,by) = m;
+    }
+}
+
+//////////////////////////////////////////////////////
+// Pixel labelling
+//////////////////////////////////////////////////////
+
+inline __device__
+int BlockLabel(const Image<int>& dBlockLabels, int bx, int by)
+{
+    return dBlockLabels(
+        max(0, min(bx, (int)dBlockLabels.w-1)),
+        max(0, min(by, (int)dBlockLabels.h-1))
+    );
+}
+
+// Pixels of blocks whose 4-neighbours share their plane keep it, others
+// take the nearest plane of their 3x3 block neighbourhood.
+__global__ void KernPlaneLabels(
+    Image<int> dLabels, const Image<float4> dVbo, const Image<int> dBlockLabels,
+    const Image<float4> dPlanes, int num_planes, int block_size, float dist_a, float dist_b
+) {
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( dLabels.InBounds(x,y) ) {
+        const float4 P = dVbo(x,y);
+        int label = -1;
+
+        if( isfinite(P.z) && P.z > 0 ) {
+            const int bx = x / block_size;
+            const int by = y / block_size;
+            const int own = BlockLabel(dBlockLabels, bx, by);
+
+            if( own >= 0 &&
+                own == BlockLabel(dBlockLabels, bx-1, by) && own == BlockLabel(dBlockLabels, bx+1, by) &&
+                own == BlockLabel(dBlockLabels, bx, by-1) && own == BlockLabel(dBlockLabels, bx, by+1) )
+            {
+                label = own;
+            }else{
+                float best_dist = PlaneSegmentMaxDist(P.z, dist_a, dist_b);
+                for(int j=-1; j <= 1; ++j) {
+                    for(int i=-1; i <= 1; ++i) {
+                        const int l = BlockLabel(dBlockLabels, bx+i, by+j);
+                        if( l >= 0 && l < num_planes ) {
+                            const float4 pl = dPlanes(l,0);
+                            const float dist = fabs(pl.x*P.x + pl.y*P.y + pl.z*P.z + pl.w);
+                            if(dist < best_dist) {
+                                best_dist = dist;
+                                label = l;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        dLabels(x,y) = label;
+    }
+}
+
+//////////////////////////////////////////////////////
+// Agglomerative merging of blocks on host
+//////////////////////////////////////////////////////
+
+struct PlaneSegmentNode
+{
+    PlaneMoments m;
+    float4 plane;
+    double mse;
+    std::set<int> neighbours;
+    int version;
+    bool alive;
+};
+
+// Priority queue entry, ordered by smallest mse first
+struct PlaneSegmentEntry
+{
+    inline bool operator<(const PlaneSegmentEntry& rhs) const {
+        return mse > rhs.mse;
+    }
+
+    double mse;
+    int node;
+    int version;
+};
+
+inline int PlaneSegmentRoot(std::vector<int>& parent, int i)
+{
+    while(parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+inline bool PlaneSegmentAcceptable(const PlaneMoments& m, double mse, float dist_a, float dist_b)
+{
+    const float max_dist = PlaneSegmentMaxDist((float)m.MeanDepth(), dist_a, dist_b);
+    return mse < max_dist*max_dist;
+}
+
+// Returns extracted planes, largest first, and writes index into them for
+// each block (-1 for none).
+inline std::vector<PlaneMoments> PlaneSegmentMerge(
+    const std::vector<PlaneMoments>& blocks, int bw, int bh, std::vector<int>& block_labels,
+    float dist_a, float dist_b, float min_cos, unsigned int min_points
+) {
+    const int n = bw*bh;
+    std::vector<PlaneSegmentNode> nodes(n);
+    std::vector<int> parent(n);
+    std::priority_queue<PlaneSegmentEntry> queue;
+
+    for(int i=0; i < n; ++i) {
+        PlaneSegmentNode& node = nodes[i];
+        parent[i] = i;
+        node.m = blocks[i];
+        node.version = 0;
+        node.alive = false;
+        if(node.m.n > 0) {
+            node.plane = node.m.Fit(node.mse);
+            node.alive = PlaneSegmentAcceptable(node.m, node.mse, dist_a, dist_b);
+        }
+    }
+
+    for(int i=0; i < n; ++i) {
+        if(!nodes[i].alive) continue;
+        const int x = i % bw;
+        const int y = i / bw;
+        if(x > 0    && nodes[i-1].alive)  nodes[i].neighbours.insert(i-1);
+        if(x+1 < bw && nodes[i+1].alive)  nodes[i].neighbours.insert(i+1);
+        if(y > 0    && nodes[i-bw].alive) nodes[i].neighbours.insert(i-bw);
+        if(y+1 < bh && nodes[i+bw].alive) nodes[i].neighbours.insert(i+bw);
+        const PlaneSegmentEntry e = {nodes[i].mse, i, 0};
+        queue.push(e);
+    }
+
+    std::vector<int> extracted;
+
+    while(!queue.empty()) {
+        const PlaneSegmentEntry e = queue.top();
+        queue.pop();
+        PlaneSegmentNode& v = nodes[e.node];
+        if( !v.alive || v.version != e.version ) continue;
+
+        // Neighbour giving best merged fit
+        int best = -1;
+        double best_mse = 0;
+        PlaneMoments best_m;
+        float4 best_plane;
+        for(std::set<int>::const_iterator it = v.neighbours.begin(); it != v.neighbours.end(); ++it) {
+            const PlaneSegmentNode& u = nodes[*it];
+            const float cos_uv = v.plane.x*u.plane.x + v.plane.y*u.plane.y + v.plane.z*u.plane.z;
+            if( cos_uv < min_cos ) continue;
+
+            PlaneMoments m = v.m;
+            m += u.m;
+            double mse;
+            const float4 plane = m.Fit(mse);
+            if( PlaneSegmentAcceptable(m, mse, dist_a, dist_b) && (best < 0 || mse < best_mse) ) {
+                best = *it;
+                best_mse = mse;
+                best_m = m;
+                best_plane = plane;
+            }
+        }
+
+        if(best >= 0) {
+            // Merge best into v
+            PlaneSegmentNode& u = nodes[best];
+            for(std::set<int>::const_iterator it = u.neighbours.begin(); it != u.neighbours.end(); ++it) {
+                if(*it == e.node) continue;
+                nodes[*it].neighbours.erase(best);
+                nodes[*it].neighbours.insert(e.node);
+                v.neighbours.insert(*it);
+            }
+            v.neighbours.erase(best);
+            u.neighbours.clear();
+            u.alive = false;
+            parent[best] = e.node;
+
+            v.m = best_m;
+            v.plane = best_plane;
+            v.mse = best_mse;
+            v.version++;
+            const PlaneSegmentEntry ev = {v.mse, e.node, v.version};
+            queue.push(ev);
+        }else{
+            // Can't grow further, so extract or discard
+            for(std::set<int>::const_iterator it = v.neighbours.begin(); it != v.neighbours.end(); ++it) {
+                nodes[*it].neighbours.erase(e.node);
+            }
+            v.neighbours.clear();
+            v.alive = false;
+            if(v.m.n >= min_points) {
+                extracted.push_back(e.node);
+            }
+        }
+    }
+
+    // Order extracted planes by support
+    std::vector<std::pair<double,int> > order;
+    for(size_t i=0; i < extracted.size(); ++i) {
+        order.push_back( std::make_pair(-nodes[extracted[i]].m.n, extracted[i]) );
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<int> root_label(n, -1);
+    std::vector<PlaneMoments> planes;
+    for(size_t i=0; i < order.size(); ++i) {
+        root_label[order[i].second] = (int)i;
+        planes.push_back(nodes[order[i].second].m);
+    }
+
+    block_labels.resize(n);
+    for(int i=0; i < n; ++i) {
+        block_labels[i] = blocks[i].n > 0 ? root_label[PlaneSegmentRoot(parent,i)] : -1;
+    }
+
+    return planes;
+}
+
+//////////////////////////////////////////////////////
+// Public interface
+//////////////////////////////////////////////////////
+
+unsigned int SegmentPlanes(
+    Image<int> dLabels, Image<float4> dPlanes, const Image<float4> dVbo,
+    Image<unsigned char> dWorkspace,
+    int block_size, float dist_a, float dist_b,
+    float min_cos, unsigned int min_points
+) {
+    const int bw = dVbo.w / block_size;
+    const int bh = dVbo.h / block_size;
+
+    Image<unsigned char> scratch = dWorkspace;
+    Image<PlaneMoments> dMoments = scratch.SplitAlignedImage<PlaneMoments>(bw, bh);
+    Image<int> dBlockLabels = scratch.SplitAlignedImage<int>(bw, bh);
+
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim, gridDim, dMoments, 16, 16);
+    KernPlaneBlockMoments<<<gridDim,blockDim>>>(dMoments, dVbo, block_size);
+
+    std::vector<PlaneMoments> blocks(bw*bh);
+    dMoments.MemcpyToHost(&blocks[0]);
+
+    std::vector<int> block_labels;
+    const std::vector<PlaneMoments> planes = PlaneSegmentMerge(
+        blocks, bw, bh, block_labels, dist_a, dist_b, min_cos, min_points
+    );
+
+    const unsigned int num_planes = std::min<unsigned int>(planes.size(), dPlanes.w);
+    if(num_planes > 0) {
+        std::vector<float4> hplanes(num_planes);
+        for(unsigned int i=0; i < num_planes; ++i) {
+            double mse;
+            hplanes[i] = planes[i].Fit(mse);
+        }
+        dPlanes.SubImage(num_planes,1).MemcpyFromHost(&hplanes[0]);
+    }
+    for(size_t i=0; i < block_labels.size(); ++i) {
+        if(block_labels[i] >= (int)num_planes) block_labels[i] = -1;
+    }
+    dBlockLabels.MemcpyFromHost(&block_labels[0]);
+
+    InitDimFromOutputImageOver(blockDim, gridDim, dLabels);
+    KernPlaneLabels<<<gridDim,blockDim>>>(dLabels, dVbo, dBlockLabels, dPlanes, num_planes, block_size, dist_a, dist_b);
+    GpuCheckErrors();
+
+    return num_planes;
+}
+
+}
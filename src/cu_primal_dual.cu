@@ -0,0 +1,604 @@
+#include "cu_primal_dual.h"
+
+#include "launch_utils.h"
+#include "Divergence.h"
+#include "Pyramid.h"
+#include "reduce.h"
+
+#include <thrust/reduce.h>
+#include <thrust/functional.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Fused Huber primal-dual iterations
+// Each block loads a PDTile x PDTile tile of u, p, g and lambda into shared
+// memory, including a K pixel apron, and runs K full iterations on it
+// without touching global memory. Each iteration invalidates one more pixel
+// at the tile border (p needs forward neighbours of u, div p needs
+// backward neighbours of p), so after K iterations only the inner
+// (PDTile-2K)^2 region is written back. Image borders use the same
+// boundary conditions as GradUFwd / DivA.
+//////////////////////////////////////////////////////
+
+const int PDTile = 32;
+
+// Primal data term proximal steps, selected at compile time. Prox(u,divp,
+// g,l,tau) is the primal descent from u along div p for data weight l.
+struct PrimalDataL2 {
+    __host__ __device__ static inline
+    float Prox(float u, float divp, float g, float l, float tau) {
+        return (u + tau * (divp + l * g)) / (1.0f + tau*l);
+    }
+};
+
+struct PrimalDataL1 {
+    __host__ __device__ static inline
+    float Prox(float u, float divp, float g, float l, float tau) {
+        const float v = u + tau * divp;
+        const float t = tau * l;
+        return (v - g > t) ? v - t : ((v - g < -t) ? v + t : g);
+    }
+};
+
+template<int K, typename Data>
+__global__ void KernHuber_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda
+) {
+    __shared__ float su[PDTile][PDTile];
+    __shared__ float2 sp[PDTile][PDTile];
+    __shared__ float sg[PDTile][PDTile];
+    __shared__ float sl[PDTile][PDTile];
+
+    const int inner = PDTile - 2*K;
+    const int ox = blockIdx.x*inner - K;
+    const int oy = blockIdx.y*inner - K;
+    const int w = uin.w;
+    const int h = uin.h;
+
+    const int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    const int nthreads = blockDim.x*blockDim.y;
+
+    // Load tile and apron
+    for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+        const int lx = i % PDTile;
+        const int ly = i / PDTile;
+        const int x = ox + lx;
+        const int y = oy + ly;
+        const bool in = 0 <= x && x < w && 0 <= y && y < h;
+        su[ly][lx] = in ? uin(x,y) : 0;
+        sp[ly][lx] = in ? pin(x,y) : make_float2(0,0);
+        sg[ly][lx] = in ? imgg(x,y) : 0;
+        sl[ly][lx] = in ? (imglambdaweight.ptr ? lambda * imglambdaweight(x,y) : lambda) : 0;
+    }
+    __syncthreads();
+
+    for(int k=0; k < K; ++k) {
+        // Dual ascent p
+        for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+            const int lx = i % PDTile;
+            const int ly = i / PDTile;
+            const int x = ox + lx;
+            const int y = oy + ly;
+            if( 0 <= x && x < w && 0 <= y && y < h ) {
+                const float u = su[ly][lx];
+                float2 du = make_float2(0,0);
+                if(x < w-1 && lx < PDTile-1) du.x = su[ly][lx+1] - u;
+                if(y < h-1 && ly < PDTile-1) du.y = su[ly+1][lx] - u;
+                sp[ly][lx] = ProjectUnitBall( (sp[ly][lx] + sigma * du) / (1 + sigma*alpha) );
+            }
+        }
+        __syncthreads();
+
+        // Primal descent u
+        for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+            const int lx = i % PDTile;
+            const int ly = i / PDTile;
+            const int x = ox + lx;
+            const int y = oy + ly;
+            if( 0 <= x && x < w && 0 <= y && y < h ) {
+                const float2 p = sp[ly][lx];
+                float divp = p.x + p.y;
+                if(x > 0 && lx > 0) divp -= sp[ly][lx-1].x;
+                if(y > 0 && ly > 0) divp -= sp[ly-1][lx].y;
+                su[ly][lx] = Data::Prox(su[ly][lx], divp, sg[ly][lx], sl[ly][lx], tau);
+            }
+        }
+        __syncthreads();
+    }
+
+    // Write back valid inner region
+    for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+        const int lx = i % PDTile;
+        const int ly = i / PDTile;
+        const int x = ox + lx;
+        const int y = oy + ly;
+        if( K <= lx && lx < PDTile-K && K <= ly && ly < PDTile-K && x < w && y < h ) {
+            uout(x,y) = su[ly][lx];
+            pout(x,y) = sp[ly][lx];
+        }
+    }
+}
+
+template<int K, typename Data>
+void Huber_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda
+) {
+    const int inner = PDTile - 2*K;
+    dim3 blockDim(16,16);
+    dim3 gridDim( (uin.w + inner-1) / inner, (uin.h + inner-1) / inner );
+    KernHuber_PrimalDualSweep<K,Data><<<gridDim,blockDim>>>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda);
+    GpuCheckErrors();
+}
+
+template<typename Data>
+void Huber_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int temporal_block
+) {
+    if(temporal_block >= 4) {
+        Huber_PrimalDualSweep<4,Data>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda);
+    }else if(temporal_block >= 2) {
+        Huber_PrimalDualSweep<2,Data>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda);
+    }else{
+        Huber_PrimalDualSweep<1,Data>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda);
+    }
+}
+
+void HuberL2_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int temporal_block
+) {
+    Huber_PrimalDualSweep<PrimalDataL2>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda,temporal_block);
+}
+
+void HuberL1_PrimalDualSweep(
+        Image<float> uout, Image<float2> pout,
+        const Image<float> uin, const Image<float2> pin,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int temporal_block
+) {
+    Huber_PrimalDualSweep<PrimalDataL1>(uout,pout,uin,pin,imgg,imglambdaweight,sigma,tau,alpha,lambda,temporal_block);
+}
+
+//////////////////////////////////////////////////////
+// Fused TGV-L1 denoising iterations
+// As above, with the TGV_L1_DenoisingIteration state (u, v, p, q, r) and
+// f in shared memory. Each iteration is the ascent of p, q and r from u
+// and v, then the descent of u and v, which again invalidates one pixel
+// per tile border (p and q need forward neighbours of u and v, the
+// descents need backward neighbours of p and q).
+//////////////////////////////////////////////////////
+
+template<int K>
+__global__ void KernTGV_L1_DenoisingSweep(
+        Image<float> uout, Image<float2> vout, Image<float2> pout, Image<float4> qout, Image<float> rout,
+        const Image<float> uin, const Image<float2> vin, const Image<float2> pin, const Image<float4> qin, const Image<float> rin,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta
+) {
+    __shared__ float su[PDTile][PDTile];
+    __shared__ float2 sv[PDTile][PDTile];
+    __shared__ float2 sp[PDTile][PDTile];
+    __shared__ float4 sq[PDTile][PDTile];
+    __shared__ float sr[PDTile][PDTile];
+    __shared__ float sf[PDTile][PDTile];
+
+    const int inner = PDTile - 2*K;
+    const int ox = blockIdx.x*inner - K;
+    const int oy = blockIdx.y*inner - K;
+    const int w = uin.w;
+    const int h = uin.h;
+
+    const int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    const int nthreads = blockDim.x*blockDim.y;
+
+    // Load tile and apron
+    for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+        const int lx = i % PDTile;
+        const int ly = i / PDTile;
+        const int x = ox + lx;
+        const int y = oy + ly;
+        const bool in = 0 <= x && x < w && 0 <= y && y < h;
+        su[ly][lx] = in ? uin(x,y) : 0;
+        sv[ly][lx] = in ? vin(x,y) : make_float2(0,0);
+        sp[ly][lx] = in ? pin(x,y) : make_float2(0,0);
+        sq[ly][lx] = in ? qin(x,y) : make_float4(0,0,0,0);
+        sr[ly][lx] = in ? rin(x,y) : 0;
+        sf[ly][lx] = in ? imgf(x,y) : 0;
+    }
+    __syncthreads();
+
+    for(int k=0; k < K; ++k) {
+        // Dual ascent p, q and r
+        for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+            const int lx = i % PDTile;
+            const int ly = i / PDTile;
+            const int x = ox + lx;
+            const int y = oy + ly;
+            if( 0 <= x && x < w && 0 <= y && y < h ) {
+                const float u = su[ly][lx];
+                const float2 v = sv[ly][lx];
+                float2 du = make_float2(0,0);
+                float2 dxv = make_float2(0,0);
+                float2 dyv = make_float2(0,0);
+                if(x < w-1 && lx < PDTile-1) {
+                    du.x = su[ly][lx+1] - u;
+                    dxv = sv[ly][lx+1] - v;
+                }
+                if(y < h-1 && ly < PDTile-1) {
+                    du.y = su[ly+1][lx] - u;
+                    dyv = sv[ly+1][lx] - v;
+                }
+                const float4 Epsv = make_float4(dxv.x, dyv.y, (dyv.x+dxv.y)/2.0f, (dyv.x+dxv.y)/2.0f);
+                sp[ly][lx] = ProjectUnitBall( sp[ly][lx] + sigma * (alpha1 * (du-v)) );
+                sq[ly][lx] = ProjectUnitBall( sq[ly][lx] + sigma * (alpha0 * Epsv) );
+                sr[ly][lx] = ProjectUnitBall( (sr[ly][lx] + sigma*(u-sf[ly][lx]) ) / (1.0f + sigma * delta) );
+            }
+        }
+        __syncthreads();
+
+        // Primal descent u and v
+        for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+            const int lx = i % PDTile;
+            const int ly = i / PDTile;
+            const int x = ox + lx;
+            const int y = oy + ly;
+            if( 0 <= x && x < w && 0 <= y && y < h ) {
+                const float2 p = sp[ly][lx];
+                const float4 q = sq[ly][lx];
+                float divp = p.x + p.y;
+                float2 divq = make_float2(q.x+q.z, q.z+q.y);
+                if(x > 0 && lx > 0) {
+                    divp -= sp[ly][lx-1].x;
+                    divq.x -= sq[ly][lx-1].x;
+                    divq.y -= sq[ly][lx-1].z;
+                }
+                if(y > 0 && ly > 0) {
+                    divp -= sp[ly-1][lx].y;
+                    divq.x -= sq[ly-1][lx].z;
+                    divq.y -= sq[ly-1][lx].y;
+                }
+                su[ly][lx] = su[ly][lx] - tau*(sr[ly][lx] - alpha1*divp);
+                sv[ly][lx] = sv[ly][lx] - tau*(-alpha1*p - alpha0*divq);
+            }
+        }
+        __syncthreads();
+    }
+
+    // Write back valid inner region
+    for(int i=tid; i < PDTile*PDTile; i += nthreads) {
+        const int lx = i % PDTile;
+        const int ly = i / PDTile;
+        const int x = ox + lx;
+        const int y = oy + ly;
+        if( K <= lx && lx < PDTile-K && K <= ly && ly < PDTile-K && x < w && y < h ) {
+            uout(x,y) = su[ly][lx];
+            vout(x,y) = sv[ly][lx];
+            pout(x,y) = sp[ly][lx];
+            qout(x,y) = sq[ly][lx];
+            rout(x,y) = sr[ly][lx];
+        }
+    }
+}
+
+template<int K>
+void TGV_L1_DenoisingSweep(
+        Image<float> uout, Image<float2> vout, Image<float2> pout, Image<float4> qout, Image<float> rout,
+        const Image<float> uin, const Image<float2> vin, const Image<float2> pin, const Image<float4> qin, const Image<float> rin,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta
+) {
+    const int inner = PDTile - 2*K;
+    dim3 blockDim(16,16);
+    dim3 gridDim( (uin.w + inner-1) / inner, (uin.h + inner-1) / inner );
+    KernTGV_L1_DenoisingSweep<K><<<gridDim,blockDim>>>(uout,vout,pout,qout,rout,uin,vin,pin,qin,rin,imgf,alpha0,alpha1,sigma,tau,delta);
+    GpuCheckErrors();
+}
+
+void TGV_L1_DenoisingSweep(
+        Image<float> uout, Image<float2> vout, Image<float2> pout, Image<float4> qout, Image<float> rout,
+        const Image<float> uin, const Image<float2> vin, const Image<float2> pin, const Image<float4> qin, const Image<float> rin,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta,
+        int temporal_block
+) {
+    if(temporal_block >= 4) {
+        TGV_L1_DenoisingSweep<4>(uout,vout,pout,qout,rout,uin,vin,pin,qin,rin,imgf,alpha0,alpha1,sigma,tau,delta);
+    }else if(temporal_block >= 2) {
+        TGV_L1_DenoisingSweep<2>(uout,vout,pout,qout,rout,uin,vin,pin,qin,rin,imgf,alpha0,alpha1,sigma,tau,delta);
+    }else{
+        TGV_L1_DenoisingSweep<1>(uout,vout,pout,qout,rout,uin,vin,pin,qin,rin,imgf,alpha0,alpha1,sigma,tau,delta);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Primal-dual gap
+// Primal: E(u) = sum h_alpha(grad u) + l/2 (u-g)^2
+// Dual:   D(p) = sum -g div p - (div p)^2 / 2l - alpha/2 |p|^2
+// Pixels with l = 0 (inpainting holes) contribute no dual data term.
+//////////////////////////////////////////////////////
+
+__global__ void KernHuberL2_PrimalDualGap(
+        const Image<float> imgu, const Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float alpha, float lambda, Image<float2> sum
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+    const unsigned int tid = threadIdx.y*blockDim.x + threadIdx.x;
+
+    __shared__ float2 sReduce[16*16];
+
+    float2 energy = make_float2(0,0);
+
+    if( x < imgu.w && y < imgu.h ) {
+        const float u = imgu(x,y);
+        const float g = imgg(x,y);
+        const float2 p = imgp(x,y);
+        const float l = imglambdaweight.ptr ? lambda * imglambdaweight(x,y) : lambda;
+
+        const float2 du = GradUFwd(imgu,u,x,y);
+        const float mag_du = sqrt(du.x*du.x + du.y*du.y);
+        const float huber = (mag_du < alpha) ? mag_du*mag_du / (2*alpha) : mag_du - alpha/2;
+
+        const float divp = DivA(imgp,x,y);
+
+        energy.x = huber + l/2 * (u-g)*(u-g);
+        energy.y = - alpha/2 * (p.x*p.x + p.y*p.y);
+        if(l > 0) {
+            energy.y += -g*divp - divp*divp / (2*l);
+        }
+    }
+
+    sReduce[tid] = energy;
+    __syncthreads();
+    for(unsigned S=blockDim.y*blockDim.x/2; S>0; S>>=1) {
+        if( tid < S ) {
+            sReduce[tid] += sReduce[tid+S];
+        }
+        __syncthreads();
+    }
+    if( tid == 0) {
+        sum(blockIdx.x, blockIdx.y) = sReduce[0];
+    }
+}
+
+float HuberL2_PrimalDualGap(
+        const Image<float> imgu, const Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float alpha, float lambda,
+        Image<unsigned char> dWorkspace
+) {
+    dim3 blockDim, gridDim;
+    InitDimFromOutputImageOver(blockDim,gridDim, imgu, 16, 16);
+
+    Image<float2> sum = dWorkspace.PackedImage<float2>(gridDim.x, gridDim.y);
+    KernHuberL2_PrimalDualGap<<<gridDim,blockDim>>>(imgu,imgp,imgg,imglambdaweight,alpha,lambda,sum);
+    GpuCheckErrors();
+
+    const float2 energy = thrust::reduce(sum.begin(), sum.end(), make_float2(0,0), thrust::plus<float2>() );
+    return energy.x - energy.y;
+}
+
+//////////////////////////////////////////////////////
+// Primal-dual solve with gap based termination
+//////////////////////////////////////////////////////
+
+// Largest temporal block that does not overshoot remaining iterations.
+inline int PrimalDualBlock(int remaining)
+{
+    return remaining >= 4 ? 4 : (remaining >= 2 ? 2 : 1);
+}
+
+int HuberL2_PrimalDualSolve(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int max_its, float gap_tol, int check_every,
+        Image<unsigned char> dWorkspace
+) {
+    Image<unsigned char> scratch = dWorkspace;
+    Image<float> imgu2 = scratch.SplitAlignedImage<float>(imgu.w, imgu.h);
+    Image<float2> imgp2 = scratch.SplitAlignedImage<float2>(imgu.w, imgu.h);
+
+    Image<float> u[2] = {imgu, imgu2};
+    Image<float2> p[2] = {imgp, imgp2};
+    int cur = 0;
+
+    int its = 0;
+    int since_check = 0;
+    while(its < max_its) {
+        const int k = PrimalDualBlock(max_its - its);
+        HuberL2_PrimalDualSweep(u[1-cur], p[1-cur], u[cur], p[cur], imgg, imglambdaweight, sigma, tau, alpha, lambda, k);
+        cur = 1-cur;
+        its += k;
+        since_check += k;
+
+        if(check_every > 0 && since_check >= check_every) {
+            since_check = 0;
+            const float gap = HuberL2_PrimalDualGap(u[cur], p[cur], imgg, imglambdaweight, alpha, lambda, scratch);
+            if(gap / imgu.Area() < gap_tol) break;
+        }
+    }
+
+    if(cur != 0) {
+        imgu.CopyFrom(u[cur]);
+        imgp.CopyFrom(p[cur]);
+    }
+
+    return its;
+}
+
+//////////////////////////////////////////////////////
+// Fixed iteration solves for the L1 data terms
+//////////////////////////////////////////////////////
+
+void HuberL1_PrimalDualSolve(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int its, Image<unsigned char> dWorkspace
+) {
+    Image<unsigned char> scratch = dWorkspace;
+    Image<float> u[2] = {imgu, scratch.SplitAlignedImage<float>(imgu.w, imgu.h)};
+    Image<float2> p[2] = {imgp, scratch.SplitAlignedImage<float2>(imgu.w, imgu.h)};
+    int cur = 0;
+
+    for(int i=0; i < its; ) {
+        const int k = PrimalDualBlock(its - i);
+        HuberL1_PrimalDualSweep(u[1-cur], p[1-cur], u[cur], p[cur], imgg, imglambdaweight, sigma, tau, alpha, lambda, k);
+        cur = 1-cur;
+        i += k;
+    }
+
+    if(cur != 0) {
+        imgu.CopyFrom(u[cur]);
+        imgp.CopyFrom(p[cur]);
+    }
+}
+
+void TGV_L1_DenoisingSolve(
+        Image<float> imgu, Image<float2> imgv,
+        Image<float2> imgp, Image<float4> imgq, Image<float> imgr,
+        const Image<float> imgf,
+        float alpha0, float alpha1, float sigma, float tau, float delta,
+        int its, Image<unsigned char> dWorkspace
+) {
+    const unsigned w = imgu.w;
+    const unsigned h = imgu.h;
+    Image<unsigned char> scratch = dWorkspace;
+    Image<float> u[2] = {imgu, scratch.SplitAlignedImage<float>(w,h)};
+    Image<float2> v[2] = {imgv, scratch.SplitAlignedImage<float2>(w,h)};
+    Image<float2> p[2] = {imgp, scratch.SplitAlignedImage<float2>(w,h)};
+    Image<float4> q[2] = {imgq, scratch.SplitAlignedImage<float4>(w,h)};
+    Image<float> r[2] = {imgr, scratch.SplitAlignedImage<float>(w,h)};
+    int cur = 0;
+
+    for(int i=0; i < its; ) {
+        const int k = PrimalDualBlock(its - i);
+        TGV_L1_DenoisingSweep(
+            u[1-cur], v[1-cur], p[1-cur], q[1-cur], r[1-cur],
+            u[cur], v[cur], p[cur], q[cur], r[cur],
+            imgf, alpha0, alpha1, sigma, tau, delta, k
+        );
+        cur = 1-cur;
+        i += k;
+    }
+
+    if(cur != 0) {
+        imgu.CopyFrom(u[cur]);
+        imgv.CopyFrom(v[cur]);
+        imgp.CopyFrom(p[cur]);
+        imgq.CopyFrom(q[cur]);
+        imgr.CopyFrom(r[cur]);
+    }
+}
+
+//////////////////////////////////////////////////////
+// Upsample u and p to next finer level
+//////////////////////////////////////////////////////
+
+__global__ void KernPrimalDualUpsample(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgucoarse, const Image<float2> imgpcoarse
+) {
+    const unsigned int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const unsigned int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < imgu.w && y < imgu.h ) {
+        // Levels are w>>l, so odd sizes are not exactly halved.
+        const float2 pc = make_float2(
+            clamp( (x+0.5f)*imgucoarse.w/imgu.w - 0.5f, 0.0f, imgucoarse.w - 1.001f ),
+            clamp( (y+0.5f)*imgucoarse.h/imgu.h - 0.5f, 0.0f, imgucoarse.h - 1.001f )
+        );
+        imgu(x,y) = imgucoarse.GetBilinear<float>(pc);
+        imgp(x,y) = ProjectUnitBall( imgpcoarse.GetBilinear<float2>(pc) );
+    }
+}
+
+//////////////////////////////////////////////////////
+// Coarse-to-fine Huber-ROF
+//////////////////////////////////////////////////////
+
+template<unsigned Levels>
+int HuberL2_PrimalDualCoarseToFine(
+        Image<float> imgu, Image<float2> imgp,
+        const Image<float> imgg, const Image<float> imglambdaweight,
+        float sigma, float tau, float alpha, float lambda,
+        int coarse_its, int fine_its, float gap_tol,
+        Image<unsigned char> dWorkspace
+) {
+    const int check_every = gap_tol > 0 ? 20 : 0;
+    const unsigned w = imgu.w;
+    const unsigned h = imgu.h;
+
+    Image<unsigned char> scratch = dWorkspace;
+    Pyramid<float,Levels> gpyr, lpyr, upyr;
+    Pyramid<float2,Levels> ppyr;
+
+    gpyr.imgs[0] = imgg;
+    lpyr.imgs[0] = imglambdaweight;
+    upyr.imgs[0] = imgu;
+    ppyr.imgs[0] = imgp;
+
+    for(unsigned l=1; l < Levels; ++l) {
+        gpyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        upyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        ppyr.imgs[l] = scratch.SplitAlignedImage<float2>(w>>l, h>>l);
+        if(imglambdaweight.ptr) {
+            lpyr.imgs[l] = scratch.SplitAlignedImage<float>(w>>l, h>>l);
+        }
+    }
+
+    BoxReduce<float,Levels,float>(gpyr);
+    if(imglambdaweight.ptr) {
+        BoxReduce<float,Levels,float>(lpyr);
+    }
+
+    upyr.imgs[Levels-1].CopyFrom(gpyr.imgs[Levels-1]);
+    ppyr.imgs[Levels-1].Memset(0);
+
+    int its = 0;
+    for(int l=Levels-1; l >= 0; --l) {
+        const float scale = (float)(1 << l);
+        its += HuberL2_PrimalDualSolve(
+            upyr.imgs[l], ppyr.imgs[l], gpyr.imgs[l], lpyr.imgs[l],
+            sigma, tau, scale*alpha, scale*lambda,
+            l == 0 ? fine_its : coarse_its, gap_tol, check_every, scratch
+        );
+
+        if(l > 0) {
+            dim3 blockDim, gridDim;
+            InitDimFromOutputImageOver(blockDim,gridDim, upyr.imgs[l-1]);
+            KernPrimalDualUpsample<<<gridDim,blockDim>>>(upyr.imgs[l-1], ppyr.imgs[l-1], upyr.imgs[l], ppyr.imgs[l]);
+            GpuCheckErrors();
+        }
+    }
+
+    return its;
+}
+
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT int HuberL2_PrimalDualCoarseToFine<2>(Image<float>, Image<float2>, const Image<float>, const Image<float>, float, float, float, float, int, int, float, Image<unsigned char>);
+template KANGAROO_EXPORT int HuberL2_PrimalDualCoarseToFine<3>(Image<float>, Image<float2>, const Image<float>, const Image<float>, float, float, float, float, int, int, float, Image<unsigned char>);
+template KANGAROO_EXPORT int HuberL2_PrimalDualCoarseToFine<4>(Image<float>, Image<float2>, const Image<float>, const Image<float>, float, float, float, float, int, int, float, Image<unsigned char>);
+
+}
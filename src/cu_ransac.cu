@@ -0,0 +1,352 @@
+#include "cu_ransac.h"
+
+#include "cu_plane_fit.h"
+#include "cu_manhattan.h"
+#include "launch_utils.h"
+#include "MatUtils.h"
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// Hypothesis generation and scoring
+//////////////////////////////////////////////////////
+
+// Attempts at drawing a valid sample for each hypothesis
+const int RansacMaxAttempts = 8;
+
+template<typename T>
+struct RansacBatch
+{
+    T model[RansacBatchSize];
+    unsigned inliers[RansacBatchSize];
+    unsigned samples;
+};
+
+inline __host__ __device__
+unsigned RansacHash(unsigned x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// Advance rng and return pixel of img it selects
+inline __device__
+int2 RansacPixel(const Image<float4>& img, unsigned& rng)
+{
+    rng = RansacHash(rng);
+    const unsigned i = rng % (img.w * img.h);
+    return make_int2(i % img.w, i / img.w);
+}
+
+inline __device__
+bool NormalValid(const float4& N)
+{
+    return N.w > 0 && isfinite(N.x) && isfinite(N.y) && isfinite(N.z);
+}
+
+struct PlaneHypothesis
+{
+    typedef float4 Model;
+    static const int SampleSize = 1;
+
+    inline __device__
+    bool Valid(const float4& P, const float4& /*N*/) const {
+        return isfinite(P.z) && zmin < P.z && P.z < zmax;
+    }
+
+    inline __device__
+    bool Hypothesis(const Image<float4>& dV, const Image<float4>& dN, unsigned rng, float4& m) const {
+        for(int a=0; a < RansacMaxAttempts; ++a) {
+            const int2 p = RansacPixel(dV, rng);
+            const float4 P = dV(p.x,p.y);
+            const float4 N = dN(p.x,p.y);
+            if( Valid(P,N) && NormalValid(N) ) {
+                m = make_float4(N.x, N.y, N.z, -(N.x*P.x + N.y*P.y + N.z*P.z));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline __device__
+    bool Inlier(const float4& m, const float4& P, const float4& N) const {
+        const float dist = m.x*P.x + m.y*P.y + m.z*P.z + m.w;
+        return fabs(dist) < max_dist &&
+               ( !NormalValid(N) || fabs(m.x*N.x + m.y*N.y + m.z*N.z) > min_cos );
+    }
+
+    float zmin;
+    float zmax;
+    float max_dist;
+    float min_cos;
+};
+
+struct ManhattanHypothesis
+{
+    typedef Mat<float,3,3> Model;
+    static const int SampleSize = 2;
+
+    inline __device__
+    bool Valid(const float4& /*P*/, const float4& N) const {
+        return NormalValid(N);
+    }
+
+    inline __device__
+    bool Hypothesis(const Image<float4>& /*dV*/, const Image<float4>& dN, unsigned rng, Mat<float,3,3>& m) const {
+        for(int a=0; a < RansacMaxAttempts; ++a) {
+            const int2 p0 = RansacPixel(dN, rng);
+            const int2 p1 = RansacPixel(dN, rng);
+            const float4 N0 = dN(p0.x,p0.y);
+            const float4 N1 = dN(p1.x,p1.y);
+            if( !NormalValid(N0) || !NormalValid(N1) ) continue;
+
+            // Normals of inliers to different axes are close to orthogonal
+            const float3 r0 = make_float3(N0.x, N0.y, N0.z);
+            const float3 n1 = make_float3(N1.x, N1.y, N1.z);
+            const float d01 = dot(r0,n1);
+            if( fabs(d01) > max_dot ) continue;
+
+            const float3 r1 = normalize(n1 - d01*r0);
+            const float3 r2 = cross(r0,r1);
+            m(0,0) = r0.x; m(0,1) = r0.y; m(0,2) = r0.z;
+            m(1,0) = r1.x; m(1,1) = r1.y; m(1,2) = r1.z;
+            m(2,0) = r2.x; m(2,1) = r2.y; m(2,2) = r2.z;
+            return true;
+        }
+        return false;
+    }
+
+    inline __device__
+    bool Inlier(const Mat<float,3,3>& m, const float4& /*P*/, const float4& N) const {
+        for(int r=0; r < 3; ++r) {
+            if( fabs(m(r,0)*N.x + m(r,1)*N.y + m(r,2)*N.z) > min_cos ) return true;
+        }
+        return false;
+    }
+
+    float min_cos;
+    float max_dot;
+};
+
+// Every block draws the same batch of hypotheses, with the first block
+// writing them out, and scores them against its pixels.
+template<typename H>
+__global__ void KernRansacScore(
+    const Image<float4> dV, const Image<float4> dN, const H hyp, int stride, unsigned seed,
+    Image<RansacBatch<typename H::Model> > dBatch
+) {
+    const int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    const unsigned int x = (blockIdx.x*blockDim.x + threadIdx.x) * stride;
+    const unsigned int y = (blockIdx.y*blockDim.y + threadIdx.y) * stride;
+
+    __shared__ typename H::Model s_model[RansacBatchSize];
+    __shared__ bool s_valid[RansacBatchSize];
+    __shared__ unsigned s_inliers[RansacBatchSize];
+    __shared__ unsigned s_samples;
+
+    if(tid < RansacBatchSize) {
+        s_valid[tid] = hyp.Hypothesis(dV, dN, RansacHash(seed + tid), s_model[tid]);
+        s_inliers[tid] = 0;
+        if(blockIdx.x == 0 && blockIdx.y == 0) {
+            dBatch(0,0).model[tid] = s_model[tid];
+        }
+    }
+    if(tid == 0) s_samples = 0;
+    __syncthreads();
+
+    if( x < dN.w && y < dN.h ) {
+        const float4 P = dV(x,y);
+        const float4 N = dN(x,y);
+        if( hyp.Valid(P,N) ) {
+            atomicAdd(&s_samples, 1u);
+            for(int h=0; h < RansacBatchSize; ++h) {
+                if( s_valid[h] && hyp.Inlier(s_model[h], P, N) ) {
+                    atomicAdd(&s_inliers[h], 1u);
+                }
+            }
+        }
+    }
+    __syncthreads();
+
+    if(tid < RansacBatchSize) {
+        atomicAdd(&dBatch(0,0).inliers[tid], s_inliers[tid]);
+    }
+    if(tid == 0) {
+        atomicAdd(&dBatch(0,0).samples, s_samples);
+    }
+}
+
+template<typename H>
+RansacModel<typename H::Model> Ransac(
+    const Image<float4> dV, const Image<float4> dN, const H& hyp,
+    Image<unsigned char> dWorkspace, int max_hypotheses, float confidence, int stride, unsigned seed
+) {
+    typedef typename H::Model Model;
+
+    dim3 blockDim(16,16);
+    dim3 gridDim(
+        (dN.w/stride + blockDim.x) / blockDim.x,
+        (dN.h/stride + blockDim.y) / blockDim.y
+    );
+
+    Image<RansacBatch<Model> > dBatch = dWorkspace.PackedImage<RansacBatch<Model> >(1,1);
+
+    RansacModel<Model> best;
+    best.inliers = 0;
+    best.samples = 0;
+    best.hypotheses = 0;
+
+    int required = max_hypotheses;
+    while( best.hypotheses < required && best.hypotheses < max_hypotheses ) {
+        RansacBatch<Model> batch;
+        for(int h=0; h < RansacBatchSize; ++h) batch.inliers[h] = 0;
+        batch.samples = 0;
+        dBatch.MemcpyFromHost(&batch);
+
+        KernRansacScore<H><<<gridDim,blockDim>>>(dV, dN, hyp, stride, RansacHash(seed) + best.hypotheses * RansacMaxAttempts, dBatch);
+        dBatch.MemcpyToHost(&batch);
+        best.hypotheses += RansacBatchSize;
+        best.samples = batch.samples;
+
+        for(int h=0; h < RansacBatchSize; ++h) {
+            if(batch.inliers[h] > best.inliers) {
+                best.inliers = batch.inliers[h];
+                best.model = batch.model[h];
+            }
+        }
+
+        // Hypotheses needed for an all inlier sample with given confidence
+        const float p = powf(best.InlierRatio(), (float)H::SampleSize);
+        if(p >= 1.0f) {
+            required = 0;
+        }else if(p > 0.0f) {
+            required = (int)ceilf( logf(1.0f - confidence) / logf(1.0f - p) );
+        }
+    }
+    GpuCheckErrors();
+
+    return best;
+}
+
+//////////////////////////////////////////////////////
+// Public interface
+//////////////////////////////////////////////////////
+
+RansacModel<float4> PlaneRansac(
+    const Image<float4> dVbo, const Image<float4> dNormals,
+    float zmin, float zmax, float max_dist, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses, float confidence, int stride, unsigned seed
+) {
+    PlaneHypothesis hyp;
+    hyp.zmin = zmin;
+    hyp.zmax = zmax;
+    hyp.max_dist = max_dist;
+    hyp.min_cos = min_cos;
+    return Ransac(dVbo, dNormals, hyp, dWorkspace, max_hypotheses, confidence, stride, seed);
+}
+
+RansacModel<Mat<float,3,3> > ManhattanRansac(
+    const Image<float4> dNormals, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses, float confidence, int stride, unsigned seed
+) {
+    ManhattanHypothesis hyp;
+    hyp.min_cos = min_cos;
+    hyp.max_dot = 2.0f * sqrtf(1.0f - min_cos*min_cos);
+    return Ransac(dNormals, dNormals, hyp, dWorkspace, max_hypotheses, confidence, stride, seed);
+}
+
+RansacModel<float4> PlaneFitRansacGN(
+    const Image<float4> dVbo, const Image<float4> dNormals,
+    const Mat<float,3,3> Qinv, Mat<float,3>& zhat,
+    Image<unsigned char> dWorkspace, Image<float> dErr,
+    float zmin, float zmax, float c, int its, float min_cos,
+    int max_hypotheses, float confidence, int stride, unsigned seed
+) {
+    const RansacModel<float4> ransac = PlaneRansac(
+        dVbo, dNormals, zmin, zmax, c, min_cos, dWorkspace, max_hypotheses, confidence, stride, seed
+    );
+
+    const float4 pl = ransac.model;
+    if( ransac.inliers == 0 || fabs(pl.w) < 1E-6f ) {
+        return ransac;
+    }
+
+    // Solve Qinv zhat = n/d by Cramer's rule
+    const Mat<float,3,3>& A = Qinv;
+    const float det =
+        A(0,0)*(A(1,1)*A(2,2) - A(1,2)*A(2,1)) -
+        A(0,1)*(A(1,0)*A(2,2) - A(1,2)*A(2,0)) +
+        A(0,2)*(A(1,0)*A(2,1) - A(1,1)*A(2,0));
+    if( fabs(det) < 1E-12f ) {
+        return ransac;
+    }
+    const float b[3] = {pl.x/pl.w, pl.y/pl.w, pl.z/pl.w};
+    for(int i=0; i < 3; ++i) {
+        Mat<float,3,3> Ai = A;
+        for(int r=0; r < 3; ++r) Ai(r,i) = b[r];
+        zhat(i) = (
+            Ai(0,0)*(Ai(1,1)*Ai(2,2) - Ai(1,2)*Ai(2,1)) -
+            Ai(0,1)*(Ai(1,0)*Ai(2,2) - Ai(1,2)*Ai(2,0)) +
+            Ai(0,2)*(Ai(1,0)*Ai(2,1) - Ai(1,1)*Ai(2,0))
+        ) / det;
+    }
+
+    // PlaneFitGN is parametrised by log(zhat)
+    for(int it=0; it < its; ++it) {
+        const LeastSquaresSystem<float,3> lss = PlaneFitGN(dVbo, Qinv, zhat, dWorkspace, dErr, zmin, zmax, c);
+        Mat<float,3> x;
+        if( !CholeskySolve(lss.JTJ, lss.JTy, x) ) break;
+        const float norm = sqrtf(x*x);
+        if( norm > 1 ) x = (1.0f / norm) * x;
+        for(int i=0; i < 3; ++i) {
+            zhat(i) *= expf(-x(i));
+        }
+    }
+
+    return ransac;
+}
+
+RansacModel<Mat<float,3,3> > ManhattanRansacGN(
+    Image<float4> out, Image<float4> out2, const Image<unsigned char> in,
+    const Image<float4> dNormals, Mat<float,3,3>& Rhat,
+    float fu, float fv, float u0, float v0,
+    float cut, float scale, float min_grad, int its, float min_cos,
+    Image<unsigned char> dWorkspace,
+    int max_hypotheses, float confidence, int stride, unsigned seed
+) {
+    const RansacModel<Mat<float,3,3> > ransac = ManhattanRansac(
+        dNormals, min_cos, dWorkspace, max_hypotheses, confidence, stride, seed
+    );
+
+    if( ransac.inliers == 0 ) {
+        return ransac;
+    }
+
+    // ManhattanLineCost linearises Rhat exp(-x)
+    Rhat = ransac.model;
+    for(int it=0; it < its; ++it) {
+        const LeastSquaresSystem<float,3> lss = ManhattanLineCost(out, out2, in, Rhat, fu, fv, u0, v0, cut, scale, min_grad, dWorkspace);
+        Mat<float,3> x;
+        if( !CholeskySolve(lss.JTJ, lss.JTy, x) ) break;
+        Mat<float,6> w;
+        for(int i=0; i < 3; ++i) {
+            w(i) = 0;
+            w(3+i) = x(i);
+        }
+        const Mat<float,3,4> T = SE3exp(w);
+        Mat<float,3,3> R;
+        for(int r=0; r < 3; ++r) for(int c=0; c < 3; ++c) R(r,c) = T(r,c);
+        Rhat = Rhat * R;
+    }
+
+    return ransac;
+}
+
+}
@@ -0,0 +1,146 @@
+#include "cu_sdf_points.h"
+
+#include "launch_utils.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <thrust/scan.h>
+
+namespace roo
+{
+
+//////////////////////////////////////////////////////
+// SDF Zero Crossing Point Extraction
+// Each thread walks one (x,y) column of voxels, testing the +x, +y and +z
+// edges of every voxel for a sign change between observed voxels. A first
+// pass counts crossings per column, a prefix sum over the counts gives each
+// column its output offset, and a second pass writes the points.
+//////////////////////////////////////////////////////
+
+template<bool Write>
+__global__ void KernSdfSurfacePoints(Image<float4> pts, Image<float4> norms, Image<float> colors, BoundedVolume<SDF_t> vol, BoundedVolume<float> colorVol, Image<unsigned int> offsets)
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    const int w = vol.w;
+    const int h = vol.h;
+    const int d = vol.d;
+
+    if( x < w && y < h ) {
+        const unsigned int col = y*w + x;
+        unsigned int n = Write ? (col > 0 ? offsets[col-1] : 0) : 0;
+
+        for(int z=0; z < d; ++z) {
+            const SDF_t s0 = vol(x,y,z);
+            if( !(s0.w > 0 && isfinite(s0.val)) ) continue;
+
+            const int3 nb[3] = { make_int3(x+1,y,z), make_int3(x,y+1,z), make_int3(x,y,z+1) };
+            for(int e=0; e<3; ++e) {
+                if( nb[e].x < w && nb[e].y < h && nb[e].z < d ) {
+                    const SDF_t s1 = vol(nb[e].x, nb[e].y, nb[e].z);
+                    if( s1.w > 0 && isfinite(s1.val) && ((s0.val < 0) != (s1.val < 0)) ) {
+                        if(Write && n < pts.Area()) {
+                            const float t = s0.val / (s0.val - s1.val);
+                            const float3 P0 = vol.VoxelPositionInUnits(x,y,z);
+                            const float3 P1 = vol.VoxelPositionInUnits(nb[e].x, nb[e].y, nb[e].z);
+                            const float3 P_w = P0 + t*(P1-P0);
+                            pts(n % pts.w, n / pts.w) = make_float4(P_w, 1);
+                            if(norms.ptr) {
+                                norms(n % norms.w, n / norms.w) = make_float4(vol.GetUnitsOutwardNormal(P_w), 0);
+                            }
+                            if(colors.ptr) {
+                                colors(n % colors.w, n / colors.w) = colorVol.IsValid() ? colorVol.GetUnitsTrilinearClamped(P_w) : 0.5f;
+                            }
+                        }
+                        ++n;
+                    }
+                }
+            }
+        }
+
+        if(!Write) {
+            offsets[col] = n;
+        }
+    }
+}
+
+unsigned int SdfSurfacePoints(Image<float4> pts, Image<float4> norms, Image<float> colors, BoundedVolume<SDF_t> vol, BoundedVolume<float> colorVol, Image<unsigned char> dWorkspace)
+{
+    Image<unsigned int> offsets = dWorkspace.PackedImage<unsigned int>(vol.w, vol.h);
+
+    dim3 blockDim(16,16);
+    dim3 gridDim( (vol.w+blockDim.x-1) / blockDim.x, (vol.h+blockDim.y-1) / blockDim.y);
+
+    KernSdfSurfacePoints<false><<<gridDim,blockDim>>>(pts, norms, colors, vol, colorVol, offsets);
+    GpuCheckErrors();
+
+    // Inclusive scan: column i writes from offsets[i-1] and the last entry is the total.
+    thrust::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+
+    unsigned int num_points = 0;
+    GpuCheckSuccess( cudaMemcpy(&num_points, &offsets[offsets.Area()-1], sizeof(unsigned int), cudaMemcpyDeviceToHost) );
+
+    KernSdfSurfacePoints<true><<<gridDim,blockDim>>>(pts, norms, colors, vol, colorVol, offsets);
+    GpuCheckErrors();
+
+    return num_points;
+}
+
+//////////////////////////////////////////////////////
+// Binary PLY point cloud export
+//////////////////////////////////////////////////////
+
+void SavePointsPly(const std::string& filename, Image<float4> pts, Image<float4> norms, Image<float> colors, unsigned int num_points)
+{
+    num_points = std::min<unsigned int>(num_points, pts.Area());
+
+    // Copy device buffers to host, treating them as linear arrays. Nothing
+    // is copied for an empty point set, leaving a valid header-only file.
+    const bool has_norms = norms.ptr && norms.Area() >= num_points;
+    const bool has_colors = colors.ptr && colors.Area() >= num_points;
+    std::vector<float4> hpts;
+    std::vector<float4> hnorms;
+    std::vector<float> hcolors;
+    if(num_points > 0) {
+        hpts.resize(pts.Area());
+        Image<float4,TargetHost>(&hpts[0], pts.w, pts.h).CopyFrom(pts);
+        if(has_norms) {
+            hnorms.resize(norms.Area());
+            Image<float4,TargetHost>(&hnorms[0], norms.w, norms.h).CopyFrom(norms);
+        }
+        if(has_colors) {
+            hcolors.resize(colors.Area());
+            Image<float,TargetHost>(&hcolors[0], colors.w, colors.h).CopyFrom(colors);
+        }
+    }
+
+    std::ofstream f(filename.c_str(), std::ios::out | std::ios::binary);
+    if(!f.is_open()) {
+        std::cerr << "Unable to open '" << filename << "' for writing." << std::endl;
+        return;
+    }
+
+    f << "ply\n";
+    f << "format binary_little_endian 1.0\n";
+    f << "element vertex " << num_points << "\n";
+    f << "property float x\nproperty float y\nproperty float z\n";
+    if(has_norms) f << "property float nx\nproperty float ny\nproperty float nz\n";
+    if(has_colors) f << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    f << "end_header\n";
+
+    for(unsigned int i=0; i < num_points; ++i) {
+        f.write((const char*)&hpts[i], 3*sizeof(float));
+        if(has_norms) {
+            f.write((const char*)&hnorms[i], 3*sizeof(float));
+        }
+        if(has_colors) {
+            const unsigned char c = (unsigned char)(255.0f * clamp(hcolors[i], 0.0f, 1.0f));
+            const unsigned char rgb[3] = {c,c,c};
+            f.write((const char*)rgb, 3);
+        }
+    }
+}
+
+}
@@ -60,6 +60,64 @@ void SdfFuse(BoundedVolume<SDF_t> vol, Image<float> depth, Image<float4> norm, M
     GpuCheckErrors();
 }
 
+//////////////////////////////////////////////////////
+// Batched Truncated SDF Fusion
+// Integrates up to N frames in one pass over the volume. Each voxel is read
+// and written once, with the running weighted mean kept in registers.
+// Frames are applied in order, so the result matches N calls to SdfFuse.
+//////////////////////////////////////////////////////
+
+template<unsigned N>
+__global__ void KernSdfFuse(BoundedVolume<SDF_t> vol, const Mat<SdfDepthFrame,N> frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta )
+{
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+    const int z = blockIdx.z*blockDim.z + threadIdx.z;
+
+    const float3 P_w = vol.VoxelPositionInUnits(x,y,z);
+
+    SDF_t curvol = vol(x,y,z);
+    bool updated = false;
+
+    for(int f=0; f<N && frames[f].depth.ptr; ++f) {
+        const SdfDepthFrame& frame = frames[f];
+        const float3 P_c = frame.T_cw * P_w;
+        const float2 p_c = K.Project(P_c);
+
+        if( frame.depth.InBounds(p_c, 2) )
+        {
+            const float vd = P_c.z;
+            const float md = frame.depth.GetBilinear<float>(p_c);
+            const float3 mdn = make_float3(frame.norm.GetBilinear<float4>(p_c));
+
+            const float costheta = dot(mdn, P_c) / -length(P_c);
+            const float sd = costheta * (md - vd);
+            const float w = costheta * 1.0f/vd;
+
+            if(sd > -trunc_dist && isfinite(md) && isfinite(w) && costheta > mincostheta ) {
+                SDF_t sdf( clamp(sd,-trunc_dist,trunc_dist) , w);
+                sdf += curvol;
+                sdf.LimitWeight(max_w);
+                curvol = sdf;
+                updated = true;
+            }
+        }
+    }
+
+    if(updated) {
+        vol(x,y,z) = curvol;
+    }
+}
+
+template<unsigned N>
+void SdfFuse(BoundedVolume<SDF_t> vol, const Mat<SdfDepthFrame,N> frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta )
+{
+    dim3 blockDim(8,8,8);
+    dim3 gridDim(vol.w / blockDim.x, vol.h / blockDim.y, vol.d / blockDim.z);
+    KernSdfFuse<N><<<gridDim,blockDim>>>(vol, frames, K, trunc_dist, max_w, mincostheta);
+    GpuCheckErrors();
+}
+
 //////////////////////////////////////////////////////
 // Color Truncated SDF Fusion
 // Similar extension to KinectFusion as described by:
@@ -223,4 +281,11 @@ void SdfDistance(Image<float> dist, Image<float> depth, BoundedVolume<SDF_t> vol
     GpuCheckErrors();
 }
 
+//////////////////////////////////////////////////////
+// Instantiate templates
+//////////////////////////////////////////////////////
+
+template KANGAROO_EXPORT void SdfFuse<8>(BoundedVolume<SDF_t> vol, const Mat<SdfDepthFrame,8> frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta);
+template KANGAROO_EXPORT void SdfFuse<16>(BoundedVolume<SDF_t> vol, const Mat<SdfDepthFrame,16> frames, ImageIntrinsics K, float trunc_dist, float max_w, float mincostheta);
+
 }
@@ -5,6 +5,7 @@
 #include <thrust/copy.h>
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/functional.h>
+#include <thrust/remove.h>
 
 
 namespace roo {
@@ -108,28 +109,7 @@ __global__ void KernHarrisScore(
         float score = 0;
 
         if(rad < x && x < img.w-rad && rad < y && y < img.h - rad ) {
-            float sum_Ixx = 0;
-            float sum_Iyy = 0;
-            float sum_Ixy = 0;
-
-            for(int sy=-rad; sy<=rad; ++sy) {
-#pragma unroll
-                for(int sx=-rad; sx<=rad; ++sx) {
-                    Mat<float,1,2> dI = img.template GetCentralDiff<float>(x+sx,y+sy);
-                    sum_Ixx += dI(0) * dI(0);
-                    sum_Iyy += dI(1) * dI(1);
-                    sum_Ixy += dI(0) * dI(1);
-                }
-            }
-
-            const int area = (2*rad+1)*(2*rad+1);
-            sum_Ixx /= area;
-            sum_Iyy /= area;
-            sum_Ixy /= area;
-
-            const float det = sum_Ixx * sum_Iyy - sum_Ixy * sum_Ixy;
-            const float trace = sum_Ixx + sum_Iyy;
-            score = det - lambda * trace*trace;
+            score = HarrisResponse(img, x, y, lambda);
         }
 
         out(x,y) = score;
@@ -186,6 +166,197 @@ void NonMaximalSuppression(Image<unsigned char> out, Image<float> scores, int ra
     KernNonMaximalSuppression<unsigned char,float><<<gridDim,blockDim>>>(out, scores, rad, threshold);
 }
 
+//////////////////////////////////////////////////////
+// Sparse keypoint detection
+//////////////////////////////////////////////////////
+
+// Cells are scanned in CellTileSize square tiles. Strict 3x3 maxima occupy
+// at most 1 in 4 pixels, so a tile yields at most MaxCellCandidates of them.
+const int CellTileSize = 32;
+const int MaxCellCandidates = CellTileSize*CellTileSize/4;
+
+struct KeypointInvalid
+{
+    inline __host__ __device__
+    bool operator()(const Keypoint& kp) const
+    {
+        return !kp.Valid();
+    }
+};
+
+__global__ void KernKeypointScore(
+    Image<float> scores, const Image<unsigned char> img, int threshold, int arc_length, bool harris_score
+) {
+    const int x = blockIdx.x*blockDim.x + threadIdx.x;
+    const int y = blockIdx.y*blockDim.y + threadIdx.y;
+
+    if( x < img.w && y < img.h ) {
+        float score = 0;
+
+        if( img.InBounds(x,y,3) ) {
+            unsigned int light, dark;
+            int sad_light, sad_dark;
+            SegmentTestMasks(img, x, y, threshold, light, dark, sad_light, sad_dark);
+
+            const bool is_light = SegmentTestArc(light, arc_length);
+            const bool is_dark = SegmentTestArc(dark, arc_length);
+
+            if(is_light || is_dark) {
+                if(harris_score) {
+                    score = max(0.0f, HarrisResponse(img, x, y, 0.04f));
+                }else{
+                    score = max(is_light ? sad_light : 0, is_dark ? sad_dark : 0);
+                }
+            }
+        }
+
+        scores(x,y) = score;
+    }
+}
+
+// Strict 3x3 maximum, ties resolved in favour of first in raster order.
+inline __device__
+bool IsLocalMax(const Image<float>& scores, int x, int y, float s)
+{
+    for(int sy=-1; sy<=1; ++sy) {
+#pragma unroll
+        for(int sx=-1; sx<=1; ++sx) {
+            const float q = scores(x+sx, y+sy);
+            if( q > s || (q == s && (sy < 0 || (sy == 0 && sx < 0))) ) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Order by descending score, ties in raster order.
+inline __device__
+bool KeypointBetter(float sa, int2 pa, float sb, int2 pb)
+{
+    return sa > sb || (sa == sb && (pa.y < pb.y || (pa.y == pb.y && pa.x < pb.x)));
+}
+
+// One block per cell. For each tile of the cell, local maxima are gathered
+// into shared memory after the best max_per_cell found so far, and ranked
+// against each other to give the new best. These are then written to this
+// cell's slots, padding with invalid. max_per_cell <= MaxCellCandidates.
+__global__ void KernKeypointBucket(
+    Image<Keypoint> cellkps, const Image<float> scores, int cell_size, int max_per_cell, int level
+) {
+    __shared__ float cand_score[2*MaxCellCandidates];
+    __shared__ int2 cand_pos[2*MaxCellCandidates];
+    __shared__ float best_score[MaxCellCandidates];
+    __shared__ int2 best_pos[MaxCellCandidates];
+    __shared__ int num_cand;
+    __shared__ int num_best;
+
+    const int tid = threadIdx.y*blockDim.x + threadIdx.x;
+    const int nthreads = blockDim.x*blockDim.y;
+
+    if(tid == 0) num_best = 0;
+
+    const int x0 = blockIdx.x * cell_size;
+    const int y0 = blockIdx.y * cell_size;
+    const int x1 = min(x0 + cell_size, (int)scores.w);
+    const int y1 = min(y0 + cell_size, (int)scores.h);
+
+    for(int ty=y0; ty < y1; ty += CellTileSize) {
+        for(int tx=x0; tx < x1; tx += CellTileSize) {
+            __syncthreads();
+            if(tid == 0) num_cand = num_best;
+            for(int i=tid; i < num_best; i += nthreads) {
+                cand_score[i] = best_score[i];
+                cand_pos[i] = best_pos[i];
+            }
+            __syncthreads();
+
+            for(int y=ty+threadIdx.y; y < min(ty+CellTileSize, y1); y += blockDim.y) {
+                for(int x=tx+threadIdx.x; x < min(tx+CellTileSize, x1); x += blockDim.x) {
+                    // Non-zero scores are at least 3 pixels from border
+                    const float s = scores(x,y);
+                    if( s > 0 && IsLocalMax(scores, x, y, s) ) {
+                        const int i = atomicAdd(&num_cand, 1);
+                        cand_score[i] = s;
+                        cand_pos[i] = make_int2(x,y);
+                    }
+                }
+            }
+            __syncthreads();
+
+            // Positions are distinct, so ranks are unique.
+            const int n = num_cand;
+            for(int i=tid; i < n; i += nthreads) {
+                const float s = cand_score[i];
+                const int2 p = cand_pos[i];
+                int rank = 0;
+                for(int j=0; j < n && rank < max_per_cell; ++j) {
+                    rank += KeypointBetter(cand_score[j], cand_pos[j], s, p) ? 1 : 0;
+                }
+                if(rank < max_per_cell) {
+                    best_score[rank] = s;
+                    best_pos[rank] = p;
+                }
+            }
+            __syncthreads();
+            if(tid == 0) num_best = min(n, max_per_cell);
+        }
+    }
+    __syncthreads();
+
+    const int cell = blockIdx.y*gridDim.x + blockIdx.x;
+    const float scale = 1 << level;
+
+    for(int r=tid; r < max_per_cell; r += nthreads) {
+        if(r < num_best) {
+            const int2 p = best_pos[r];
+            cellkps(cell*max_per_cell + r, 0) = Keypoint( (p.x + 0.5f)*scale - 0.5f, (p.y + 0.5f)*scale - 0.5f, best_score[r], level );
+        }else{
+            cellkps(cell*max_per_cell + r, 0) = Keypoint(0, 0, 0, -1);
+        }
+    }
+}
+
+template<unsigned Levels>
+unsigned int DetectKeypoints(
+    Image<Keypoint> keypoints, const Pyramid<unsigned char,Levels> pyr, Image<unsigned char> dWorkspace,
+    unsigned char threshold, unsigned char arc_length, int cell_size, int max_per_cell, bool harris_score
+) {
+    unsigned int num_keypoints = 0;
+    max_per_cell = min(max_per_cell, MaxCellCandidates);
+
+    for(unsigned l=0; l < Levels; ++l) {
+        const Image<unsigned char> img = pyr.imgs[l];
+
+        Image<unsigned char> scratch = dWorkspace;
+        Image<float> scores = scratch.SplitAlignedImage<float>(img.w, img.h);
+        const dim3 cells( ceil(img.w / (double)cell_size), ceil(img.h / (double)cell_size) );
+        Image<Keypoint> cellkps = scratch.SplitAlignedImage<Keypoint>(cells.x*cells.y*max_per_cell, 1);
+
+        dim3 blockDim, gridDim;
+        InitDimFromOutputImageOver(blockDim,gridDim, img);
+        KernKeypointScore<<<gridDim,blockDim>>>(scores, img, threshold, arc_length, harris_score);
+
+        blockDim = dim3(16,16);
+        gridDim = cells;
+        KernKeypointBucket<<<gridDim,blockDim>>>(cellkps, scores, cell_size, max_per_cell, l);
+        GpuCheckErrors();
+
+        // Compact valid keypoints into output
+        const unsigned int n = thrust::remove_if(cellkps.begin(), cellkps.end(), KeypointInvalid()) - cellkps.begin();
+        const unsigned int ncopy = min(n, (unsigned int)keypoints.w - num_keypoints);
+        thrust::copy(cellkps.begin(), cellkps.begin() + ncopy, keypoints.begin() + num_keypoints);
+        num_keypoints += ncopy;
+    }
+
+    return num_keypoints;
+}
+
+template KANGAROO_EXPORT unsigned int DetectKeypoints<1>(Image<Keypoint>, const Pyramid<unsigned char,1>, Image<unsigned char>, unsigned char, unsigned char, int, int, bool);
+template KANGAROO_EXPORT unsigned int DetectKeypoints<2>(Image<Keypoint>, const Pyramid<unsigned char,2>, Image<unsigned char>, unsigned char, unsigned char, int, int, bool);
+template KANGAROO_EXPORT unsigned int DetectKeypoints<3>(Image<Keypoint>, const Pyramid<unsigned char,3>, Image<unsigned char>, unsigned char, unsigned char, int, int, bool);
+template KANGAROO_EXPORT unsigned int DetectKeypoints<4>(Image<Keypoint>, const Pyramid<unsigned char,4>, Image<unsigned char>, unsigned char, unsigned char, int, int, bool);
+
 //////////////////////////////////////////////////////
 // Compact into index list - Untested
 //////////////////////////////////////////////////////